@@ -0,0 +1,106 @@
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Scout/Batch.hpp"
+
+static void printUsage()
+{
+    std::cerr << "usage: scout-batch [--threads n] [--timeout ms] [--cache-budget mb] [--cache-dir dir] [--format f] [--unordered] [--list file] [path...]\n"
+                 "  path       a relation file or a directory whose *.rel files are closed\n"
+                 "  --list     file with one relation path per line\n"
+                 "  --threads  relations closed at the same time, defaults to the number of hardware threads\n"
+                 "  --timeout  time limit per relation in milliseconds, 0 (the default) disables it\n"
+                 "  --cache-budget  megabytes of cached powers kept per relation beyond the checkpoints, 0 (the default) keeps all\n"
+                 "  --cache-dir  directory of closures reused across runs for relations equal up to variable names\n"
+                 "  --format   text (the default), smt for SMT-LIB or json\n"
+                 "  --unordered  report relations as they finish instead of in input order\n";
+}
+
+int main(int argc, char** argv)
+{
+    scout::BatchOptions options;
+    std::vector<std::string> paths;
+    std::vector<std::string> files;
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            auto hasValue = i + 1 < argc;
+            if (std::strcmp(argv[i], "--threads") == 0 && hasValue)
+            {
+                options.threads = std::stoi(argv[++i]);
+            }
+            else if (std::strcmp(argv[i], "--timeout") == 0 && hasValue)
+            {
+                options.timeout = std::chrono::milliseconds(std::stol(argv[++i]));
+            }
+            else if (std::strcmp(argv[i], "--cache-budget") == 0 && hasValue)
+            {
+                options.powerCacheBudget = std::stoul(argv[++i]) << 20;
+            }
+            else if (std::strcmp(argv[i], "--cache-dir") == 0 && hasValue)
+            {
+                options.cacheDirectory = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--format") == 0 && hasValue)
+            {
+                options.format = scout::ClosureWriter::ParseFormat(argv[++i]);
+            }
+            else if (std::strcmp(argv[i], "--unordered") == 0)
+            {
+                options.ordered = false;
+            }
+            else if (std::strcmp(argv[i], "--list") == 0 && hasValue)
+            {
+                auto listed = scout::Batch::ReadFileList(argv[++i]);
+                paths.insert(paths.end(), listed.begin(), listed.end());
+            }
+            else if (argv[i][0] == '-')
+            {
+                printUsage();
+                return 2;
+            }
+            else
+            {
+                paths.emplace_back(argv[i]);
+            }
+        }
+        files = scout::Batch::CollectFiles(paths);
+    }
+    catch (std::exception const& e)
+    {
+        std::cerr << e.what() << '\n';
+        return 2;
+    }
+    if (files.empty())
+    {
+        printUsage();
+        return 2;
+    }
+
+    // every result is tagged with its file, so the unordered stream can be matched up as well
+    int failures = 0;
+    scout::Batch::Run(files, options,
+                      [&](scout::BatchResult const& result)
+                      {
+                          std::cout << "== " << result.file << " (" << result.elapsed.count() * 1000 << " ms)\n";
+                          switch (result.status)
+                          {
+                          case scout::BatchResult::CLOSED:
+                              std::cout << result.output << '\n';
+                              break;
+                          case scout::BatchResult::TIMEOUT:
+                              std::cout << "TIMEOUT\n";
+                              ++failures;
+                              break;
+                          case scout::BatchResult::FAILED:
+                              std::cout << "ERROR " << result.output << '\n';
+                              ++failures;
+                              break;
+                          }
+                          std::cout.flush();
+                      });
+    return failures == 0 ? 0 : 1;
+}
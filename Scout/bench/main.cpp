@@ -0,0 +1,479 @@
+// scout-bench: times the phases of the transitive closure on the dataset and on generated relations and writes the
+// results as JSON. Run it from the repository root or pass --dataset.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Scout/Batch.hpp"
+#include "Scout/MatrixOperations.hpp"
+#include "Scout/Parser.hpp"
+#include "Scout/Relation.hpp"
+
+using clock_type = std::chrono::steady_clock;
+
+struct BenchOptions
+{
+    std::string dataset = "dataset";
+    bool runDataset = true;
+    bool runSynthetic = true;
+    std::vector<int> sizes = {8, 16, 32, 64, 128, 256};
+    std::vector<int> periods = {1, 2, 3, 5};
+    std::string filter;
+    int repetitions = 3;
+    int powers = 8;
+    int threads = 1;
+    bool checkAllocations = false;
+    std::chrono::milliseconds timeout{5000};
+    std::string output;
+};
+
+// the fastest of all repetitions, per phase
+struct Timings
+{
+    std::optional<double> parse;
+    std::optional<double> initialClosure;
+    std::vector<double> powers;
+    std::optional<double> maxConsistent;
+    std::optional<double> maxPeriodic;
+    std::optional<double> transitiveClosure;
+    // counters of the last closure, only with SCOUT_STATS
+    std::optional<scout::ClosureStats> stats;
+    // AllocationCount during a second CloseInPlace and ComposeClosedInto of R^1, only with --check-allocations
+    std::optional<std::uint64_t> allocations;
+    std::string status = "closed";
+    std::string error;
+};
+
+struct BenchCase
+{
+    std::string name;
+    std::string kind;
+    // either a file or the relation itself
+    std::string file;
+    std::string relation;
+    int variables = 0;
+    bool octagonal = false;
+    int period = 0;
+};
+
+static double millisecondsSince(clock_type::time_point start) { return std::chrono::duration<double, std::milli>(clock_type::now() - start).count(); }
+
+static void keepMin(std::optional<double>& current, double value) { current = current ? std::min(*current, value) : value; }
+
+// R1: ... relation with n variables x_1..x_n. The first period variables are rotated, which gives the closure that
+// period; the remaining ones are counters and copies, guarded by random difference (or octagonal) constraints.
+static std::string makeRelation(int n, bool octagonal, int period, unsigned seed)
+{
+    std::mt19937 random(seed);
+    auto var = [](int i) { return "x_" + std::to_string(i); };
+    std::vector<std::string> conjuncts;
+    period = std::min(period, n);
+    for (int i = 1; i <= period; ++i)
+    {
+        conjuncts.emplace_back(var(i % period + 1) + "'=" + var(i));
+    }
+    for (int i = period + 1; i <= n; ++i)
+    {
+        switch (random() % 3)
+        {
+        case 0:
+            conjuncts.emplace_back(var(i) + "'=" + std::to_string(int(random() % 3)) + "+" + var(i));
+            break;
+        case 1:
+            conjuncts.emplace_back(var(i) + "'=" + var(int(random() % n) + 1));
+            break;
+        default:
+            conjuncts.emplace_back(var(i) + "'<=" + std::to_string(int(random() % 5)) + "+" + var(int(random() % n) + 1));
+            conjuncts.emplace_back(var(i) + "'>=" + var(i));
+            break;
+        }
+    }
+    // guards with non-negative constants keep the relation satisfiable by all zeros
+    for (int g = 0; g < n; ++g)
+    {
+        auto i = int(random() % n) + 1;
+        auto j = int(random() % n) + 1;
+        auto c = std::to_string(int(random() % 10));
+        if (i == j)
+        {
+            conjuncts.emplace_back(var(i) + "<=" + c);
+        }
+        else if (octagonal && random() % 2)
+        {
+            conjuncts.emplace_back(random() % 2 ? var(i) + "+" + var(j) + "<=" + c : "-" + var(i) + "-" + var(j) + "<=" + c);
+        }
+        else
+        {
+            conjuncts.emplace_back(var(i) + "<=" + c + "+" + var(j));
+        }
+    }
+    if (octagonal)
+    {
+        // at least one sum keeps the relation octagonal
+        conjuncts.emplace_back(var(1) + "+" + var(n) + "<=" + std::to_string(2 * n));
+    }
+
+    std::string relation;
+    for (auto const& conjunct : conjuncts)
+    {
+        if (!relation.empty())
+        {
+            relation += "&&";
+        }
+        relation += conjunct;
+    }
+    return relation;
+}
+
+// RetrieveRelation in two parts: everything up to the formula is parsing, MakeRelation builds and closes R^1
+static scout::Relation parseCase(BenchCase const& benchCase, Timings& timings)
+{
+    auto start = clock_type::now();
+    scout::Relation r;
+    auto relation = benchCase.file.empty() ? benchCase.relation : scout::Parser::ReadRelation(benchCase.file);
+    auto tokens = scout::Parser::TokenizeRelation(relation, r);
+    auto formula = scout::Parser::MakeFormula(tokens);
+    formula = scout::Parser::AddTokens(formula);
+    formula = scout::Parser::NormalizeTokens(formula);
+    r.SetIsOctagonal(scout::Parser::VerifyValidity(formula));
+    keepMin(timings.parse, millisecondsSince(start));
+
+    start = clock_type::now();
+    scout::Parser::MakeRelation(formula, r);
+    keepMin(timings.initialClosure, millisecondsSince(start));
+    return r;
+}
+
+// Closes R^1 and composes it with itself twice on the same workspace and counts the allocations of the second time,
+// which the in-place kernels promise to run without any.
+static std::uint64_t countAllocations(scout::Relation& r)
+{
+    auto& workspace = scout::Workspace::Local();
+    auto power = r.GetPowerOfRelation(1);
+    auto tighten = r.GetIsOctagonal();
+    scout::matrix closed;
+    scout::matrix composed;
+    std::uint64_t before = 0;
+    for (int run = 0; run < 2; ++run)
+    {
+        closed = *power;
+        before = scout::AllocationCount();
+        scout::MatrixOperations::CloseInPlace(closed, tighten, workspace);
+        scout::MatrixOperations::ComposeClosedInto(composed, closed, closed, tighten, workspace);
+    }
+    return scout::AllocationCount() - before;
+}
+
+static void runPhases(BenchCase const& benchCase, BenchOptions const& options, Timings& timings)
+{
+    auto r = parseCase(benchCase, timings);
+    if (options.checkAllocations)
+    {
+        timings.allocations = std::max(timings.allocations.value_or(0), countAllocations(r));
+    }
+    auto deadline = clock_type::now() + options.timeout;
+
+    // powers one at a time, every call composes the previous power with R^1
+    auto powers = r;
+    for (int power = 2; power <= options.powers && clock_type::now() < deadline; ++power)
+    {
+        auto start = clock_type::now();
+        powers.CalcAddPowerOfRelation(power);
+        auto elapsed = millisecondsSince(start);
+        if (timings.powers.size() < std::size_t(power - 1))
+        {
+            timings.powers.emplace_back(elapsed);
+        }
+        else
+        {
+            timings.powers[power - 2] = std::min(timings.powers[power - 2], elapsed);
+        }
+    }
+
+    // MaxConsistent and MaxPeriodic on the first candidate with c = 1 that algorithm 1 would examine as well
+    for (int b = 1; b + 2 <= options.powers && powers.SearchPowerOfRelation(b + 2).first == b + 2; ++b)
+    {
+        auto p0 = powers.GetPowerOfRelation(b);
+        auto p1 = powers.GetPowerOfRelation(b + 1);
+        auto p2 = powers.GetPowerOfRelation(b + 2);
+        if (!scout::Relation::ConsistencyCheck(*p1) || !scout::Relation::ConsistencyCheck(*p2))
+        {
+            break;
+        }
+        auto Lambda = scout::MatrixOperations::IntegerMatrixSubtraction(*p1, *p0);
+        if (!(Lambda == scout::MatrixOperations::IntegerMatrixSubtraction(*p2, *p1)))
+        {
+            continue;
+        }
+        auto LambdaB = scout::MatrixOperations::MatrixAddition(*p0, Lambda);
+        scout::MatrixOperations::CloseInPlace(LambdaB, false);
+
+        auto start = clock_type::now();
+        static_cast<void>(powers.MaxConsistent(b, LambdaB));
+        keepMin(timings.maxConsistent, millisecondsSince(start));
+
+        start = clock_type::now();
+        static_cast<void>(powers.MaxPeriodic(LambdaB, 1));
+        keepMin(timings.maxPeriodic, millisecondsSince(start));
+        break;
+    }
+
+    auto closure = r;
+    closure.SetDeadline(clock_type::now() + options.timeout);
+    auto start = clock_type::now();
+    closure.CalculateTransitiveClosure();
+    keepMin(timings.transitiveClosure, millisecondsSince(start));
+    if constexpr (scout::COLLECT_STATS)
+    {
+        timings.stats = closure.GetStats();
+    }
+}
+
+static Timings runCase(BenchCase const& benchCase, BenchOptions const& options)
+{
+    Timings timings;
+    for (int repetition = 0; repetition < options.repetitions; ++repetition)
+    {
+        try
+        {
+            runPhases(benchCase, options, timings);
+        }
+        catch (scout::ClosureTimeout const&)
+        {
+            timings.status = "timeout";
+            break;
+        }
+        catch (std::exception const& e)
+        {
+            timings.status = "failed";
+            timings.error = e.what();
+            break;
+        }
+    }
+    return timings;
+}
+
+static std::vector<BenchCase> collectCases(BenchOptions const& options)
+{
+    std::vector<BenchCase> cases;
+    if (options.runDataset && std::filesystem::is_directory(options.dataset))
+    {
+        for (auto const& file : scout::Batch::CollectFiles({options.dataset}))
+        {
+            BenchCase benchCase;
+            benchCase.name = std::filesystem::path(file).filename().string();
+            benchCase.kind = "dataset";
+            benchCase.file = file;
+            cases.emplace_back(benchCase);
+        }
+    }
+    if (options.runSynthetic)
+    {
+        for (auto octagonal : {false, true})
+        {
+            for (auto n : options.sizes)
+            {
+                for (auto period : options.periods)
+                {
+                    BenchCase benchCase;
+                    benchCase.kind = "synthetic";
+                    benchCase.variables = n;
+                    benchCase.octagonal = octagonal;
+                    benchCase.period = period;
+                    benchCase.name = std::string(octagonal ? "octagon" : "dbr") + "-n" + std::to_string(n) + "-p" + std::to_string(period);
+                    benchCase.relation = makeRelation(n, octagonal, period, unsigned(n * 31 + period));
+                    cases.emplace_back(benchCase);
+                }
+            }
+        }
+    }
+    if (!options.filter.empty())
+    {
+        std::erase_if(cases, [&](BenchCase const& benchCase) { return benchCase.name.find(options.filter) == std::string::npos; });
+    }
+    return cases;
+}
+
+static std::string quoted(std::string const& value)
+{
+    std::string out = "\"";
+    for (auto c : value)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out + "\"";
+}
+
+static void writeNumber(std::ostream& out, char const* key, std::optional<double> value)
+{
+    out << ", " << quoted(key) << ": ";
+    if (value)
+    {
+        out << *value;
+    }
+    else
+    {
+        out << "null";
+    }
+}
+
+static void writeCase(std::ostream& out, BenchCase const& benchCase, Timings const& timings)
+{
+    out << "    {\"name\": " << quoted(benchCase.name) << ", \"kind\": " << quoted(benchCase.kind);
+    if (benchCase.kind == "synthetic")
+    {
+        out << ", \"variables\": " << benchCase.variables << ", \"octagonal\": " << (benchCase.octagonal ? "true" : "false")
+            << ", \"period\": " << benchCase.period;
+    }
+    out << ", \"status\": " << quoted(timings.status);
+    if (!timings.error.empty())
+    {
+        out << ", \"error\": " << quoted(timings.error);
+    }
+    writeNumber(out, "parse_ms", timings.parse);
+    writeNumber(out, "initial_closure_ms", timings.initialClosure);
+    out << ", \"powers_ms\": [";
+    for (std::size_t i = 0; i < timings.powers.size(); ++i)
+    {
+        out << (i == 0 ? "" : ", ") << timings.powers[i];
+    }
+    out << "]";
+    writeNumber(out, "max_consistent_ms", timings.maxConsistent);
+    writeNumber(out, "max_periodic_ms", timings.maxPeriodic);
+    writeNumber(out, "transitive_closure_ms", timings.transitiveClosure);
+    if (timings.allocations)
+    {
+        out << ", \"allocations\": " << *timings.allocations;
+    }
+    if (timings.stats)
+    {
+        out << ", \"stats\": ";
+        timings.stats->PrintJson(out);
+    }
+    out << "}";
+}
+
+static std::vector<int> parseList(char const* text)
+{
+    std::vector<int> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        values.emplace_back(std::stoi(item));
+    }
+    return values;
+}
+
+static void printUsage()
+{
+    std::cerr << "usage: scout-bench [options]\n"
+                 "  --dataset dir       relation files to time (default: dataset)\n"
+                 "  --no-dataset        skip the dataset\n"
+                 "  --no-synthetic      skip the generated relations\n"
+                 "  --sizes a,b,...     variable counts of the generated relations (default: 8,16,32,64,128,256)\n"
+                 "  --periods a,b,...   periods of the generated relations (default: 1,2,3,5)\n"
+                 "  --filter text       only cases whose name contains text\n"
+                 "  --repetitions r     runs per case, the fastest is reported (default: 3)\n"
+                 "  --powers p          powers timed one by one (default: 8)\n"
+                 "  --threads t         MatrixOperations thread count (default: 1)\n"
+                 "  --check-allocations count the allocations of a second CloseInPlace and ComposeClosedInto of R^1\n"
+                 "                      and exit with 1 if a case has any\n"
+                 "  --timeout ms        limit for the powers and the transitive closure of one run (default: 5000)\n"
+                 "  --output file       write the JSON there instead of stdout\n";
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            auto hasValue = i + 1 < argc;
+            auto is = [&](char const* flag) { return std::strcmp(argv[i], flag) == 0; };
+            if (is("--dataset") && hasValue)
+                options.dataset = argv[++i];
+            else if (is("--no-dataset"))
+                options.runDataset = false;
+            else if (is("--no-synthetic"))
+                options.runSynthetic = false;
+            else if (is("--sizes") && hasValue)
+                options.sizes = parseList(argv[++i]);
+            else if (is("--periods") && hasValue)
+                options.periods = parseList(argv[++i]);
+            else if (is("--filter") && hasValue)
+                options.filter = argv[++i];
+            else if (is("--repetitions") && hasValue)
+                options.repetitions = std::max(1, std::stoi(argv[++i]));
+            else if (is("--powers") && hasValue)
+                options.powers = std::stoi(argv[++i]);
+            else if (is("--threads") && hasValue)
+                options.threads = std::stoi(argv[++i]);
+            else if (is("--check-allocations"))
+                options.checkAllocations = true;
+            else if (is("--timeout") && hasValue)
+                options.timeout = std::chrono::milliseconds(std::stol(argv[++i]));
+            else if (is("--output") && hasValue)
+                options.output = argv[++i];
+            else
+            {
+                printUsage();
+                return 2;
+            }
+        }
+        scout::MatrixOperations::SetThreadCount(options.threads);
+    }
+    catch (std::exception const& e)
+    {
+        std::cerr << e.what() << '\n';
+        return 2;
+    }
+
+    std::ofstream file;
+    if (!options.output.empty())
+    {
+        file.open(options.output);
+        if (!file)
+        {
+            std::cerr << "cannot write " << options.output << '\n';
+            return 2;
+        }
+    }
+    auto& out = options.output.empty() ? std::cout : file;
+
+    auto cases = collectCases(options);
+    std::size_t allocating = 0;
+    out << "{\n  \"threads\": " << options.threads << ",\n  \"repetitions\": " << options.repetitions << ",\n  \"timeout_ms\": " << options.timeout.count()
+        << ",\n  \"cases\": [\n";
+    for (std::size_t i = 0; i < cases.size(); ++i)
+    {
+        std::cerr << "[" << i + 1 << "/" << cases.size() << "] " << cases[i].name << '\n';
+        auto timings = runCase(cases[i], options);
+        if (timings.allocations.value_or(0) > 0)
+        {
+            std::cerr << cases[i].name << ": " << *timings.allocations << " allocations in the warmed up kernels\n";
+            ++allocating;
+        }
+        writeCase(out, cases[i], timings);
+        out << (i + 1 < cases.size() ? ",\n" : "\n");
+        out.flush();
+    }
+    out << "  ]\n}\n";
+    return allocating > 0 ? 1 : 0;
+}
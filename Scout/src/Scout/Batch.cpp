@@ -0,0 +1,179 @@
+#include "Batch.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+#include "Parser.hpp"
+#include "Relation.hpp"
+#include "ThreadPool.hpp"
+
+// files waiting for one worker; the owner takes from the front, other workers steal from the back
+struct WorkQueue
+{
+    std::mutex mutex;
+    std::deque<std::size_t> indices;
+};
+
+static std::optional<std::size_t> takeWork(std::vector<WorkQueue>& queues, int worker)
+{
+    {
+        auto& own = queues[worker];
+        std::lock_guard lock(own.mutex);
+        if (!own.indices.empty())
+        {
+            auto index = own.indices.front();
+            own.indices.pop_front();
+            return index;
+        }
+    }
+    // no new work shows up during a batch, so one unsuccessful round over all queues means everything is taken
+    for (std::size_t offset = 1; offset < queues.size(); ++offset)
+    {
+        auto& victim = queues[(worker + offset) % queues.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.indices.empty())
+        {
+            auto index = victim.indices.back();
+            victim.indices.pop_back();
+            return index;
+        }
+    }
+    return std::nullopt;
+}
+
+std::vector<std::string> scout::Batch::CollectFiles(std::vector<std::string> const& paths)
+{
+    std::vector<std::string> files;
+    for (auto const& path : paths)
+    {
+        if (!std::filesystem::is_directory(path))
+        {
+            files.emplace_back(path);
+            continue;
+        }
+        std::vector<std::string> directoryFiles;
+        for (auto const& entry : std::filesystem::directory_iterator(path))
+        {
+            if (entry.is_regular_file() && entry.path().extension() == ".rel")
+            {
+                directoryFiles.emplace_back(entry.path().string());
+            }
+        }
+        std::sort(directoryFiles.begin(), directoryFiles.end());
+        files.insert(files.end(), directoryFiles.begin(), directoryFiles.end());
+    }
+    return files;
+}
+
+std::vector<std::string> scout::Batch::ReadFileList(std::string const& listPath)
+{
+    std::ifstream file(listPath);
+    if (!file)
+    {
+        throw std::invalid_argument("No such File exists");
+    }
+    std::vector<std::string> files;
+    std::string line;
+    while (getline(file, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        if (!line.empty())
+        {
+            files.emplace_back(line);
+        }
+    }
+    return files;
+}
+
+void scout::Batch::Run(std::vector<std::string> const& files, BatchOptions const& options, std::function<void(BatchResult const&)> const& report)
+{
+    if (files.empty())
+    {
+        return;
+    }
+    auto threads = options.threads > 0 ? options.threads : int(std::max(1u, std::thread::hardware_concurrency()));
+    threads = int(std::min<std::size_t>(threads, files.size()));
+
+    // round robin keeps the heads of all queues close to the start of the list, which keeps ordered reporting flowing
+    std::vector<WorkQueue> queues(threads);
+    for (std::size_t index = 0; index < files.size(); ++index)
+    {
+        queues[index % threads].indices.push_back(index);
+    }
+
+    std::mutex reportMutex;
+    std::map<std::size_t, BatchResult> pending;
+    std::size_t nextIndex = 0;
+
+    ThreadPool pool(threads);
+    pool.ParallelFor(threads,
+                     [&](int worker, int)
+                     {
+                         while (auto index = takeWork(queues, worker))
+                         {
+                             auto result = CloseFile(files[*index], options);
+                             result.index = *index;
+
+                             std::lock_guard lock(reportMutex);
+                             if (!options.ordered)
+                             {
+                                 report(result);
+                                 continue;
+                             }
+                             pending.emplace(*index, std::move(result));
+                             for (auto it = pending.find(nextIndex); it != pending.end(); it = pending.find(nextIndex))
+                             {
+                                 report(it->second);
+                                 pending.erase(it);
+                                 ++nextIndex;
+                             }
+                         }
+                     });
+}
+
+scout::BatchResult scout::Batch::CloseFile(std::string const& file, BatchOptions const& options)
+{
+    BatchResult result;
+    result.file = file;
+    auto start = std::chrono::steady_clock::now();
+    try
+    {
+        auto r = Parser::RetrieveRelation(file);
+        r.SetPowerCacheBudget(options.powerCacheBudget);
+        if (!options.cacheDirectory.empty())
+        {
+            r.SetCacheDirectory(options.cacheDirectory);
+        }
+        if (options.timeout.count() > 0)
+        {
+            r.SetDeadline(start + options.timeout);
+        }
+        r.CalculateTransitiveClosure();
+
+        BufferSink sink(result.output);
+        r.WriteTransitiveClosure(sink, options.format);
+        result.status = BatchResult::CLOSED;
+    }
+    catch (ClosureTimeout const& e)
+    {
+        result.output = e.what();
+        result.status = BatchResult::TIMEOUT;
+    }
+    catch (std::exception const& e)
+    {
+        result.output = e.what();
+        result.status = BatchResult::FAILED;
+    }
+    result.elapsed = std::chrono::steady_clock::now() - start;
+    return result;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "ClosureWriter.hpp"
+
+namespace scout
+{
+
+struct BatchOptions
+{
+    // number of relations processed at the same time, 0 picks one per hardware thread
+    int threads = 0;
+    // per file limit for parsing and closing a relation, 0 disables it
+    std::chrono::milliseconds timeout{0};
+    // if true results are reported in the order of the input files, otherwise as soon as they are done
+    bool ordered = true;
+    // Relation::SetPowerCacheBudget of every relation in bytes, 0 keeps all powers
+    std::size_t powerCacheBudget = 0;
+    // Relation::SetCacheDirectory of every relation, empty disables the closure cache
+    std::filesystem::path cacheDirectory;
+    // format of BatchResult::output
+    ClosureWriter::closureFormat format = ClosureWriter::TEXT;
+};
+
+struct BatchResult
+{
+    enum resultStatus
+    {
+        CLOSED,
+        TIMEOUT,
+        FAILED
+    } status{};
+    // position of the file in the input list
+    std::size_t index = 0;
+    std::string file;
+    // the transitive closure in BatchOptions::format, or the error message if the relation failed
+    std::string output;
+    std::chrono::duration<double> elapsed{};
+};
+
+namespace Batch
+{
+// a directory expands to its *.rel files in lexicographic order, every other path is taken as a relation file
+std::vector<std::string> CollectFiles(std::vector<std::string> const& paths);
+
+// reads one path per line, empty lines are skipped
+std::vector<std::string> ReadFileList(std::string const& listPath);
+
+// parses and closes every file. Files are handed out by work stealing, so a few expensive relations do not hold up the
+// rest. report is never called concurrently.
+void Run(std::vector<std::string> const& files, BatchOptions const& options, std::function<void(BatchResult const&)> const& report);
+
+// RetrieveRelation + CalculateTransitiveClosure + WriteTransitiveClosure for a single file; options.threads and
+// options.ordered do not apply
+BatchResult CloseFile(std::string const& file, BatchOptions const& options);
+} // namespace Batch
+} // namespace scout
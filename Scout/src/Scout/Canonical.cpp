@@ -0,0 +1,126 @@
+#include "Canonical.hpp"
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+
+// matrix indices that belong to one variable: x and x' for DBRs, +x, -x, +x' and -x' for octagons
+static int indicesPerVariable(bool isOctagonal) { return isOctagonal ? 4 : 2; }
+
+static int variableCount(scout::matrix const& m, bool isOctagonal) { return m.Size() / indicesPerVariable(isOctagonal); }
+
+// the role-th matrix index of variable v
+static int matrixIndex(int v, int role, int variables, bool isOctagonal)
+{
+    if (!isOctagonal)
+    {
+        return v + role * variables;
+    }
+    return 2 * v + role % 2 + role / 2 * 2 * variables;
+}
+
+static int variableOf(int index, int variables, bool isOctagonal) { return isOctagonal ? index % (2 * variables) / 2 : index % variables; }
+
+static int roleOf(int index, int variables, bool isOctagonal)
+{
+    if (!isOctagonal)
+    {
+        return index / variables;
+    }
+    return index % 2 + index / (2 * variables) * 2;
+}
+
+std::vector<int> scout::Canonical::VariableOrder(matrix const& m, bool isOctagonal)
+{
+    auto variables = variableCount(m, isOctagonal);
+    auto roles = indicesPerVariable(isOctagonal);
+
+    // (direction, own role, other role, same variable, alpha, beta) of every constraint on the variable
+    typedef std::array<std::int64_t, 6> constraint;
+    std::vector<std::vector<constraint>> signatures(variables);
+    for (int v = 0; v < variables; ++v)
+    {
+        auto& signature = signatures[v];
+        for (int role = 0; role < roles; ++role)
+        {
+            auto a = matrixIndex(v, role, variables, isOctagonal);
+            for (int b = 0; b < m.Size(); ++b)
+            {
+                auto otherRole = roleOf(b, variables, isOctagonal);
+                auto same = variableOf(b, variables, isOctagonal) == v;
+                for (auto [alpha, beta] : m(a, b))
+                {
+                    signature.push_back({0, role, otherRole, same, alpha, beta});
+                }
+                for (auto [alpha, beta] : m(b, a))
+                {
+                    signature.push_back({1, role, otherRole, same, alpha, beta});
+                }
+            }
+        }
+        std::sort(signature.begin(), signature.end());
+    }
+
+    std::vector<int> order(variables);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int v, int w) { return signatures[v] < signatures[w]; });
+    return order;
+}
+
+scout::matrix scout::Canonical::PermuteVariables(matrix const& m, std::vector<int> const& order, bool isOctagonal)
+{
+    auto variables = variableCount(m, isOctagonal);
+    std::vector<int> source(m.Size());
+    for (int i = 0; i < m.Size(); ++i)
+    {
+        source[i] = matrixIndex(order[variableOf(i, variables, isOctagonal)], roleOf(i, variables, isOctagonal), variables, isOctagonal);
+    }
+    matrix result(m.Size());
+    for (int i = 0; i < m.Size(); ++i)
+    {
+        for (int j = 0; j < m.Size(); ++j)
+        {
+            result.Assign(i, j, m(source[i], source[j]));
+        }
+    }
+    return result;
+}
+
+std::vector<int> scout::Canonical::InvertOrder(std::vector<int> const& order)
+{
+    std::vector<int> inverse(order.size());
+    for (std::size_t k = 0; k < order.size(); ++k)
+    {
+        inverse[order[k]] = int(k);
+    }
+    return inverse;
+}
+
+std::uint64_t scout::Canonical::Hash(matrix const& m, bool isOctagonal)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    auto add = [&](std::int64_t value)
+    {
+        for (int byte = 0; byte < 8; ++byte)
+        {
+            hash ^= std::uint64_t(value >> (8 * byte)) & 0xff;
+            hash *= 1099511628211ull;
+        }
+    };
+    add(m.Size());
+    add(isOctagonal);
+    for (int i = 0; i < m.Size(); ++i)
+    {
+        for (int j = 0; j < m.Size(); ++j)
+        {
+            auto c = m(i, j);
+            add(std::int64_t(c.size()));
+            for (auto [alpha, beta] : c)
+            {
+                add(alpha);
+                add(beta);
+            }
+        }
+    }
+    return hash;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Matrix.hpp"
+
+namespace scout
+{
+// Relations that only differ in the names and order of their variables or the order of their conjuncts have the same
+// closed R^1 up to a permutation of the variables. The canonical form picks that permutation from the structure of R^1.
+namespace Canonical
+{
+// order[k] is the variable placed at position k of the canonical form. Variables are sorted by the sorted list of the
+// constraints they take part in, ties keep their original order.
+std::vector<int> VariableOrder(matrix const& m, bool isOctagonal);
+
+// the matrix with variable order[k] moved to position k; primed and unprimed copies and octagon halves move together
+matrix PermuteVariables(matrix const& m, std::vector<int> const& order, bool isOctagonal);
+
+// the inverse permutation, which moves a permuted matrix back
+std::vector<int> InvertOrder(std::vector<int> const& order);
+
+// FNV-1a over the cells; equal matrices have equal hashes
+std::uint64_t Hash(matrix const& m, bool isOctagonal);
+} // namespace Canonical
+} // namespace scout
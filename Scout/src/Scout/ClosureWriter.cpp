@@ -0,0 +1,428 @@
+#include "ClosureWriter.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <stdexcept>
+#include <system_error>
+
+#include "Relation.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <io.h>
+#endif
+
+// ===============================================
+// sinks
+
+scout::StreamSink::StreamSink(std::ostream& out) : out(out) {}
+
+void scout::StreamSink::Write(std::string_view data) { out.write(data.data(), std::streamsize(data.size())); }
+
+scout::FileDescriptorSink::FileDescriptorSink(int fd) : fd(fd) {}
+
+void scout::FileDescriptorSink::Write(std::string_view data)
+{
+    while (!data.empty())
+    {
+#ifdef _WIN32
+        auto count = ::_write(fd, data.data(), unsigned(std::min<std::size_t>(data.size(), 1u << 30)));
+#else
+        auto count = ::write(fd, data.data(), data.size());
+#endif
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "Writing the closure failed");
+        }
+        data.remove_prefix(std::size_t(count));
+    }
+}
+
+scout::BufferSink::BufferSink(std::string& buffer) : buffer(buffer) {}
+
+void scout::BufferSink::Write(std::string_view data) { buffer.append(data); }
+
+// ===============================================
+// writer
+
+scout::ClosureWriter::ClosureWriter(OutputSink& sink, closureFormat format, std::size_t bufferSize)
+    : sink(sink), format(format), bufferSize(std::max<std::size_t>(bufferSize, 64))
+{
+    buffer.reserve(this->bufferSize);
+}
+
+scout::ClosureWriter::~ClosureWriter()
+{
+    try
+    {
+        Flush();
+    }
+    catch (...)
+    {
+    }
+}
+
+scout::ClosureWriter::closureFormat scout::ClosureWriter::ParseFormat(std::string_view name)
+{
+    if (name == "text")
+    {
+        return TEXT;
+    }
+    if (name == "smt" || name == "smtlib")
+    {
+        return SMT_LIB;
+    }
+    if (name == "json")
+    {
+        return JSON;
+    }
+    throw std::invalid_argument("Unknown output format " + std::string(name));
+}
+
+void scout::ClosureWriter::Write(Relation const& r)
+{
+    auto const& closure = r.GetTransitiveClosure();
+    Begin(r, closure.size());
+    for (auto const& part : closure)
+    {
+        WriteDisjunct(*part);
+    }
+    End();
+}
+
+void scout::ClosureWriter::Begin(Relation const& r, std::size_t parts)
+{
+    auto const& symbols = r.GetSymbolTable();
+    auto const& names = symbols.Names();
+    this->variables.clear();
+    this->variables.reserve(2 * names.size());
+    this->variables.insert(this->variables.end(), names.begin(), names.end());
+    for (auto const& name : names)
+    {
+        this->variables.push_back(name + "'");
+    }
+    this->isOctagonal = r.GetIsOctagonal();
+    this->parts = parts;
+    this->written = 0;
+
+    switch (this->format)
+    {
+    case TEXT:
+        break;
+    case SMT_LIB:
+        Append(";Variable declarations\n");
+        for (auto const& name : names)
+        {
+            Append("(declare-fun |");
+            Append(name);
+            Append("| () Int)\n(declare-fun |");
+            Append(name);
+            Append("'| () Int)\n");
+        }
+        Append("(declare-fun |$k| () Int)\n");
+        Append("(declare-fun k () Int)\n");
+        Append("(declare-fun t0 () bool)\n");
+        Append("(declare-fun t1 () bool)\n");
+        for (std::size_t i = 0; i < parts; ++i)
+        {
+            Append("(declare-fun s");
+            AppendNumber((long long)i);
+            Append(" () bool)\n");
+        }
+        Append("\n;Constraints\n");
+        break;
+    case JSON:
+        Append("{\"variables\": [");
+        for (std::size_t i = 0; i < names.size(); ++i)
+        {
+            if (i > 0)
+            {
+                Append(", ");
+            }
+            AppendJsonString(names[i]);
+        }
+        Append("], \"octagonal\": ");
+        Append(this->isOctagonal ? "true" : "false");
+        Append(", \"closure\": [");
+        break;
+    }
+}
+
+void scout::ClosureWriter::WriteDisjunct(matrix const& m)
+{
+    this->containsK = false;
+    this->firstBound = true;
+    switch (this->format)
+    {
+    case TEXT:
+        Append('(');
+        break;
+    case SMT_LIB:
+        Append("(assert (= s");
+        AppendNumber((long long)this->written);
+        Append(" (and ");
+        break;
+    case JSON:
+        if (this->written > 0)
+        {
+            Append(", ");
+        }
+        Append("{\"constraints\": [");
+        break;
+    }
+
+    if (this->isOctagonal)
+    {
+        int relationHalfSize = m.Size() / 2;
+        for (int i = 0; i < relationHalfSize; ++i)
+        {
+            for (int j = i; j < relationHalfSize; ++j)
+            {
+                if (i == j)
+                {
+                    WriteBound(m(2 * i, 2 * i + 1), i, j, '\0', '+');
+                    WriteBound(m(2 * i + 1, 2 * i), i, j, '-', '-');
+                    continue;
+                }
+
+                // def 2.18, a bound is only written if the coherent cell agrees with it
+                if (std::ranges::equal(m(2 * i, 2 * j), m(2 * j + 1, 2 * i + 1)))
+                {
+                    WriteBound(m(2 * i, 2 * j), i, j, '\0', '-');
+                }
+                if (std::ranges::equal(m(2 * j, 2 * i), m(2 * i + 1, 2 * j + 1)))
+                {
+                    WriteBound(m(2 * j, 2 * i), i, j, '-', '+');
+                }
+                if (std::ranges::equal(m(2 * i + 1, 2 * j), m(2 * j + 1, 2 * i)))
+                {
+                    WriteBound(m(2 * i + 1, 2 * j), i, j, '-', '-');
+                }
+                if (std::ranges::equal(m(2 * i, 2 * j + 1), m(2 * j, 2 * i + 1)))
+                {
+                    WriteBound(m(2 * i, 2 * j + 1), i, j, '\0', '+');
+                }
+            }
+        }
+    }
+    else
+    {
+        for (int i = 0; i < m.Size(); ++i)
+        {
+            for (int j = 0; j < m.Size(); ++j)
+            {
+                if (i != j)
+                {
+                    WriteBound(m(i, j), i, j, '\0', '-');
+                }
+            }
+        }
+    }
+
+    ++this->written;
+    switch (this->format)
+    {
+    case TEXT:
+        Append(this->containsK ? " k >= 0)" : " )");
+        if (this->written < this->parts)
+        {
+            Append(" || \n");
+        }
+        break;
+    case SMT_LIB:
+        Append(this->containsK ? " (>= |$k| 0))))\n" : " )))\n");
+        break;
+    case JSON:
+        Append("], \"k_nonnegative\": ");
+        Append(this->containsK ? "true" : "false");
+        Append('}');
+        break;
+    }
+    if (this->buffer.size() >= this->bufferSize)
+    {
+        Flush();
+    }
+}
+
+void scout::ClosureWriter::End()
+{
+    switch (this->format)
+    {
+    case TEXT:
+        break;
+    case SMT_LIB:
+        Append("\n(assert (= t0 (or");
+        for (std::size_t i = 0; i < this->written; ++i)
+        {
+            Append(" s");
+            AppendNumber((long long)i);
+        }
+        Append(")))");
+        break;
+    case JSON:
+        Append("]}\n");
+        break;
+    }
+    Flush();
+}
+
+void scout::ClosureWriter::Flush()
+{
+    if (!this->buffer.empty())
+    {
+        this->sink.Write(this->buffer);
+        this->buffer.clear();
+    }
+}
+
+void scout::ClosureWriter::WriteBound(cell_view c, int i, int j, char signOne, char signTwo)
+{
+    if (c.empty())
+    {
+        return;
+    }
+    auto alpha = c[0].first;
+    auto beta = c[0].second;
+    if (alpha != 0)
+    {
+        this->containsK = true;
+    }
+    static std::string const unknown = "null";
+    auto const& left = std::size_t(i) < this->variables.size() ? this->variables[i] : unknown;
+    auto const& right = std::size_t(j) < this->variables.size() ? this->variables[j] : unknown;
+
+    switch (this->format)
+    {
+    case TEXT:
+        if (signOne == '-')
+        {
+            Append(signOne);
+        }
+        Append(left);
+        Append(signTwo);
+        Append(right);
+        Append("<=");
+        if (alpha != 0)
+        {
+            AppendNumber(alpha);
+            Append('k');
+            if (beta > 0)
+            {
+                Append('+');
+            }
+        }
+        if (alpha == 0 || beta != 0)
+        {
+            AppendNumber(beta);
+        }
+        Append(',');
+        break;
+    case SMT_LIB:
+        Append("(<= (");
+        Append(signTwo);
+        Append(' ');
+        if (signOne == '-')
+        {
+            Append("(- ");
+            AppendSmtVariable(i);
+            Append(')');
+        }
+        else
+        {
+            AppendSmtVariable(i);
+        }
+        Append(' ');
+        AppendSmtVariable(j);
+        Append(") ");
+        if (beta != 0 && alpha != 0)
+        {
+            Append("(+ (* ");
+            AppendNumber(alpha);
+            Append(" |$k|) ");
+            AppendNumber(beta);
+            Append(')');
+        }
+        else if (alpha != 0)
+        {
+            Append("(* ");
+            AppendNumber(alpha);
+            Append(" |$k|)");
+        }
+        else
+        {
+            AppendNumber(beta);
+        }
+        Append(") ");
+        break;
+    case JSON:
+        if (!this->firstBound)
+        {
+            Append(", ");
+        }
+        Append("{\"left\": ");
+        AppendJsonString(left);
+        Append(", \"left_sign\": \"");
+        Append(signOne == '-' ? '-' : '+');
+        Append("\", \"right\": ");
+        AppendJsonString(right);
+        Append(", \"right_sign\": \"");
+        Append(signTwo);
+        Append("\", \"k\": ");
+        AppendNumber(alpha);
+        Append(", \"constant\": ");
+        AppendNumber(beta);
+        Append('}');
+        break;
+    }
+    this->firstBound = false;
+}
+
+void scout::ClosureWriter::Append(std::string_view data)
+{
+    if (this->buffer.size() + data.size() > this->bufferSize)
+    {
+        Flush();
+        if (data.size() > this->bufferSize)
+        {
+            this->sink.Write(data);
+            return;
+        }
+    }
+    this->buffer.append(data);
+}
+
+void scout::ClosureWriter::Append(char c) { Append(std::string_view(&c, 1)); }
+
+void scout::ClosureWriter::AppendNumber(long long value)
+{
+    char digits[24];
+    auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+    Append(std::string_view(digits, std::size_t(end - digits)));
+}
+
+void scout::ClosureWriter::AppendSmtVariable(int index)
+{
+    Append('|');
+    Append(std::size_t(index) < this->variables.size() ? std::string_view(this->variables[index]) : std::string_view("null"));
+    Append('|');
+}
+
+void scout::ClosureWriter::AppendJsonString(std::string_view text)
+{
+    Append('"');
+    for (auto c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            Append('\\');
+        }
+        Append(c);
+    }
+    Append('"');
+}
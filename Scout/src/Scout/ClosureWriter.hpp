@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Matrix.hpp"
+
+namespace scout
+{
+class Relation;
+
+// where a ClosureWriter puts its output; Write receives whole buffers, not single constraints
+class OutputSink
+{
+public:
+    virtual ~OutputSink() = default;
+    virtual void Write(std::string_view data) = 0;
+};
+
+class StreamSink : public OutputSink
+{
+public:
+    explicit StreamSink(std::ostream& out);
+    void Write(std::string_view data) override;
+
+private:
+    std::ostream& out;
+};
+
+// writes to an open file descriptor, e.g. 1 for stdout; the descriptor is not closed
+class FileDescriptorSink : public OutputSink
+{
+public:
+    explicit FileDescriptorSink(int fd);
+    void Write(std::string_view data) override;
+
+private:
+    int fd;
+};
+
+// appends to a string owned by the caller
+class BufferSink : public OutputSink
+{
+public:
+    explicit BufferSink(std::string& buffer);
+    void Write(std::string_view data) override;
+
+private:
+    std::string& buffer;
+};
+
+// Writes transitive closures to a sink, one disjunct at a time. Output is collected in an internal buffer of
+// bufferSize bytes that is handed to the sink whenever it is full, so a closure is never held as one string.
+// TEXT is the format of Relation::PrintTransitiveClosure, SMT_LIB declares the variables and asserts t0 as the
+// disjunction of the closure parts, JSON lists every constraint with its variables, their signs, and the factor of k and
+// the constant of its bound.
+class ClosureWriter
+{
+public:
+    enum closureFormat
+    {
+        TEXT,
+        SMT_LIB,
+        JSON
+    };
+
+    static constexpr std::size_t DEFAULT_BUFFER_SIZE = std::size_t(1) << 16;
+
+    ClosureWriter(OutputSink& sink, closureFormat format, std::size_t bufferSize = DEFAULT_BUFFER_SIZE);
+    // flushes what is left in the buffer; call Flush before to see errors of the sink
+    ~ClosureWriter();
+
+    ClosureWriter(ClosureWriter const&) = delete;
+    ClosureWriter& operator=(ClosureWriter const&) = delete;
+
+    // Begin, every part of the transitive closure and End
+    void Write(Relation const& r);
+
+    // For writing the parts while they are computed: Begin takes the number of parts, which SMT_LIB has to declare up
+    // front, and the variables of the relation.
+    void Begin(Relation const& r, std::size_t parts);
+    void WriteDisjunct(matrix const& m);
+    void End();
+
+    void Flush();
+
+    // "text", "smt" / "smtlib" or "json"; throws std::invalid_argument otherwise
+    static closureFormat ParseFormat(std::string_view name);
+
+private:
+    // one bound ±variables[i] ±variables[j] <= alpha * k + beta of the closure part
+    void WriteBound(cell_view c, int i, int j, char signOne, char signTwo);
+
+    void Append(std::string_view data);
+    void Append(char c);
+    void AppendNumber(long long value);
+    void AppendSmtVariable(int index);
+    void AppendJsonString(std::string_view text);
+
+    OutputSink& sink;
+    closureFormat format;
+    std::size_t bufferSize;
+    std::string buffer;
+    // matrix index -> name, the primed copies follow the variables
+    std::vector<std::string> variables;
+    bool isOctagonal = false;
+    std::size_t parts = 0;
+    std::size_t written = 0;
+    // whether the current disjunct has a bound with k, and for JSON whether it has any bound yet
+    bool containsK = false;
+    bool firstBound = true;
+};
+} // namespace scout
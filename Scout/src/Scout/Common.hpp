@@ -1,13 +1,154 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace scout
 {
-constexpr bool MAKE_SMT = false;
+// heap allocations made by counting_allocator, i.e. for cells, matrices and the scratch buffers of the kernels
+inline std::atomic<std::uint64_t> allocationCounter{0};
+
+inline std::uint64_t AllocationCount() { return allocationCounter.load(std::memory_order_relaxed); }
+
+// std::allocator that counts its allocations in allocationCounter
+template <typename T>
+struct counting_allocator
+{
+    typedef T value_type;
+
+    counting_allocator() = default;
+
+    template <typename U>
+    counting_allocator(counting_allocator<U> const&) noexcept
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        allocationCounter.fetch_add(1, std::memory_order_relaxed);
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, std::size_t n) { std::allocator<T>().deallocate(p, n); }
+
+    template <typename U>
+    bool operator==(counting_allocator<U> const&) const noexcept
+    {
+        return true;
+    }
+};
+
+template <typename T>
+using counted_vector = std::vector<T, counting_allocator<T>>;
+
+// Type of alpha and beta of a term, chosen with the SCOUT_TERM_TYPE option: int32 (the default), int64 for relations
+// whose constants do not fit, or checked, which keeps int32 terms and throws TermOverflow where their arithmetic would
+// wrap. The integer kernels of non-parametric matrices pick int32 or int64 by their constants in every mode.
+#ifdef SCOUT_TERM_INT64
+typedef std::int64_t term_value;
+#else
+typedef std::int32_t term_value;
+#endif
+
+#ifdef SCOUT_TERM_CHECKED
+constexpr bool CHECK_TERM_OVERFLOW = true;
+static_assert(sizeof(term_value) < sizeof(std::int64_t), "checked terms are computed in int64 where the builtins are missing");
+#else
+constexpr bool CHECK_TERM_OVERFLOW = false;
+#endif
+
+// thrown if a term value does not fit term_value; the arithmetic below only throws it with checked terms
+class TermOverflow : public std::overflow_error
+{
+public:
+    using std::overflow_error::overflow_error;
+};
+
+// value as a term_value, TermOverflow if it does not fit
+inline term_value NarrowTerm(std::int64_t value)
+{
+    if (value < std::numeric_limits<term_value>::min() || value > std::numeric_limits<term_value>::max())
+    {
+        throw TermOverflow("Term value " + std::to_string(value) + " out of range");
+    }
+    return term_value(value);
+}
+
+// a result of the integer kernels as a term_value, clamped to its range; checked terms throw TermOverflow instead
+inline term_value ClampTerm(std::int64_t value)
+{
+    if constexpr (CHECK_TERM_OVERFLOW)
+    {
+        return NarrowTerm(value);
+    }
+    return term_value(std::clamp<std::int64_t>(value, std::numeric_limits<term_value>::min(), std::numeric_limits<term_value>::max()));
+}
+
+// a + b, a - b and a * b on term values; unless terms are checked this is plain arithmetic that is not checked at all
+inline term_value TermSum(term_value a, term_value b)
+{
+    if constexpr (CHECK_TERM_OVERFLOW)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        term_value sum;
+        if (__builtin_add_overflow(a, b, &sum))
+        {
+            throw TermOverflow("Term overflow in " + std::to_string(a) + " + " + std::to_string(b));
+        }
+        return sum;
+#else
+        return NarrowTerm(std::int64_t(a) + std::int64_t(b));
+#endif
+    }
+    return a + b;
+}
+
+inline term_value TermDifference(term_value a, term_value b)
+{
+    if constexpr (CHECK_TERM_OVERFLOW)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        term_value difference;
+        if (__builtin_sub_overflow(a, b, &difference))
+        {
+            throw TermOverflow("Term overflow in " + std::to_string(a) + " - " + std::to_string(b));
+        }
+        return difference;
+#else
+        return NarrowTerm(std::int64_t(a) - std::int64_t(b));
+#endif
+    }
+    return a - b;
+}
+
+inline term_value TermProduct(term_value a, term_value b)
+{
+    if constexpr (CHECK_TERM_OVERFLOW)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        term_value product;
+        if (__builtin_mul_overflow(a, b, &product))
+        {
+            throw TermOverflow("Term overflow in " + std::to_string(a) + " * " + std::to_string(b));
+        }
+        return product;
+#else
+        return NarrowTerm(std::int64_t(a) * std::int64_t(b));
+#endif
+    }
+    return a * b;
+}
 
 // typedefs
-typedef std::vector<std::pair<int, int>> cell;
-typedef std::vector<std::vector<cell>> matrix;
+typedef std::pair<term_value, term_value> term;
+typedef counted_vector<term> cell;
+typedef std::span<term const> cell_view;
 } // namespace scout
@@ -0,0 +1,535 @@
+#include "DenseMatrix.hpp"
+#include "MatrixOperations.hpp"
+#include "Stats.hpp"
+
+#include <atomic>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+// rowI[j] = min(rowI[j], ik + rowK[j]) for all j, INF in rowK stays INF. ik has to be finite.
+template <typename T>
+static void relaxRow(T* rowI, T const* rowK, T ik, int stride)
+{
+    using dm = scout::dense_matrix<T>;
+    for (int j = 0; j < stride; ++j)
+    {
+        auto kj = rowK[j];
+        auto candidate = kj == dm::INF ? dm::INF : dm::Saturate(ik + kj);
+        rowI[j] = std::min(rowI[j], candidate);
+    }
+}
+
+#if defined(__AVX512F__)
+template <>
+void relaxRow<std::int32_t>(std::int32_t* rowI, std::int32_t const* rowK, std::int32_t ik, int stride)
+{
+    using dm = scout::dense_matrix<std::int32_t>;
+    auto vik = _mm512_set1_epi32(ik);
+    auto inf = _mm512_set1_epi32(dm::INF);
+    auto lo = _mm512_set1_epi32(dm::MIN_FINITE);
+    auto hi = _mm512_set1_epi32(dm::MAX_FINITE);
+    for (int j = 0; j < stride; j += 16)
+    {
+        auto kj = _mm512_loadu_si512(rowK + j);
+        auto candidate = _mm512_min_epi32(_mm512_max_epi32(_mm512_add_epi32(vik, kj), lo), hi);
+        candidate = _mm512_mask_mov_epi32(candidate, _mm512_cmpeq_epi32_mask(kj, inf), inf);
+        _mm512_storeu_si512(rowI + j, _mm512_min_epi32(_mm512_loadu_si512(rowI + j), candidate));
+    }
+}
+
+template <>
+void relaxRow<std::int64_t>(std::int64_t* rowI, std::int64_t const* rowK, std::int64_t ik, int stride)
+{
+    using dm = scout::dense_matrix<std::int64_t>;
+    auto vik = _mm512_set1_epi64(ik);
+    auto inf = _mm512_set1_epi64(dm::INF);
+    auto lo = _mm512_set1_epi64(dm::MIN_FINITE);
+    auto hi = _mm512_set1_epi64(dm::MAX_FINITE);
+    for (int j = 0; j < stride; j += 8)
+    {
+        auto kj = _mm512_loadu_si512(rowK + j);
+        auto candidate = _mm512_min_epi64(_mm512_max_epi64(_mm512_add_epi64(vik, kj), lo), hi);
+        candidate = _mm512_mask_mov_epi64(candidate, _mm512_cmpeq_epi64_mask(kj, inf), inf);
+        _mm512_storeu_si512(rowI + j, _mm512_min_epi64(_mm512_loadu_si512(rowI + j), candidate));
+    }
+}
+#elif defined(__AVX2__)
+template <>
+void relaxRow<std::int32_t>(std::int32_t* rowI, std::int32_t const* rowK, std::int32_t ik, int stride)
+{
+    using dm = scout::dense_matrix<std::int32_t>;
+    auto vik = _mm256_set1_epi32(ik);
+    auto inf = _mm256_set1_epi32(dm::INF);
+    auto lo = _mm256_set1_epi32(dm::MIN_FINITE);
+    auto hi = _mm256_set1_epi32(dm::MAX_FINITE);
+    for (int j = 0; j < stride; j += 8)
+    {
+        auto kj = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(rowK + j));
+        auto candidate = _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(vik, kj), lo), hi);
+        candidate = _mm256_blendv_epi8(candidate, inf, _mm256_cmpeq_epi32(kj, inf));
+        auto ij = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(rowI + j));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(rowI + j), _mm256_min_epi32(ij, candidate));
+    }
+}
+
+template <>
+void relaxRow<std::int64_t>(std::int64_t* rowI, std::int64_t const* rowK, std::int64_t ik, int stride)
+{
+    // AVX2 has no 64 bit min/max, they are built from compare and blend
+    using dm = scout::dense_matrix<std::int64_t>;
+    auto vik = _mm256_set1_epi64x(ik);
+    auto inf = _mm256_set1_epi64x(dm::INF);
+    auto lo = _mm256_set1_epi64x(dm::MIN_FINITE);
+    auto hi = _mm256_set1_epi64x(dm::MAX_FINITE);
+    for (int j = 0; j < stride; j += 4)
+    {
+        auto kj = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(rowK + j));
+        auto candidate = _mm256_add_epi64(vik, kj);
+        candidate = _mm256_blendv_epi8(candidate, lo, _mm256_cmpgt_epi64(lo, candidate));
+        candidate = _mm256_blendv_epi8(candidate, hi, _mm256_cmpgt_epi64(candidate, hi));
+        candidate = _mm256_blendv_epi8(candidate, inf, _mm256_cmpeq_epi64(kj, inf));
+        auto ij = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(rowI + j));
+        ij = _mm256_blendv_epi8(ij, candidate, _mm256_cmpgt_epi64(ij, candidate));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(rowI + j), ij);
+    }
+}
+#endif
+
+// below this size a row loop is too short to be worth handing to other threads
+static constexpr int PARALLEL_MIN_SIZE = 256;
+
+// calls rows(begin, end, thread) on blocks of [0, size), in parallel for large matrices
+template <typename F>
+static void forRowBlocks(int size, F const& rows)
+{
+    auto& pool = scout::MatrixOperations::GetThreadPool();
+    if (pool.Size() == 1 || size < PARALLEL_MIN_SIZE)
+    {
+        rows(0, size, 0);
+        return;
+    }
+    auto blocks = std::min(size, 4 * pool.Size());
+    pool.ParallelFor(blocks, [&](int block, int thread) { rows(block * size / blocks, (block + 1) * size / blocks, thread); });
+}
+
+template <typename T>
+static void floydWarshall(scout::dense_matrix<T>& m)
+{
+    auto size = m.Size();
+    std::atomic<std::uint64_t> relaxedRows = 0;
+    for (int k = 0; k < size; ++k)
+    {
+        // row k is not changed in step k, so the rows can be relaxed in any order
+        auto const* rowK = m.Row(k);
+        forRowBlocks(size,
+                     [&](int begin, int end, int)
+                     {
+                         std::uint64_t rows = 0;
+                         for (int i = begin; i < end; ++i)
+                         {
+                             auto ik = m(i, k);
+                             if (i == k || ik == scout::dense_matrix<T>::INF)
+                             {
+                                 continue;
+                             }
+                             relaxRow(m.Row(i), rowK, ik, m.Stride());
+                             // like the parametric version, column k is not relaxed through itself
+                             m(i, k) = ik;
+                             ++rows;
+                         }
+                         if constexpr (scout::COLLECT_STATS)
+                         {
+                             relaxedRows.fetch_add(rows, std::memory_order_relaxed);
+                         }
+                     });
+    }
+    scout::RecordStats([&](scout::ClosureStats& stats) { stats.relaxations += relaxedRows.load() * std::uint64_t(size); });
+}
+
+template <typename T>
+static void tightClosure(scout::dense_matrix<T>& m, scout::dense_scratch<T>& scratch)
+{
+    using dm = scout::dense_matrix<T>;
+    auto size = m.Size();
+
+    // halves of m[j'][j]; the row halves m[i][i'] are read before row i is changed
+    auto& halves = scratch.halves;
+    halves.assign(m.Stride(), dm::INF);
+    for (int j = 0; j < size; ++j)
+    {
+        auto value = m(scout::MatrixOperations::IDash(j), j);
+        halves[j] = value == dm::INF ? dm::INF : value >> 1;
+    }
+    forRowBlocks(size,
+                 [&](int begin, int end, int)
+                 {
+                     for (int i = begin; i < end; ++i)
+                     {
+                         auto value = m(i, scout::MatrixOperations::IDash(i));
+                         if (value != dm::INF)
+                         {
+                             relaxRow(m.Row(i), halves.data(), T(value >> 1), m.Stride());
+                         }
+                     }
+                 });
+}
+
+// With stopIfEmpty it returns false as soon as a diagonal cell of res is negative, which relaxing and tightening only ever
+// lower. res is then unfinished. Otherwise it returns true.
+template <typename T>
+static bool composeClosed(scout::dense_matrix<T> const& m1, scout::dense_matrix<T> const& m2, bool tighten, scout::dense_matrix<T>& res,
+                          scout::dense_scratch<T>& scratch, bool stopIfEmpty)
+{
+    using dm = scout::dense_matrix<T>;
+    auto baseSize = m1.Size();
+    auto halfSize = baseSize / 2;
+
+    // Both operands are closed, so a path between outer variables only needs the shared variables as intermediates, where
+    // it may switch between m1 and m2 arbitrarily often. Close the shared block first.
+    auto& shared = scratch.shared;
+    shared.Reset(halfSize);
+    for (int a = 0; a < halfSize; ++a)
+    {
+        for (int b = 0; b < halfSize; ++b)
+        {
+            shared(a, b) = std::min(m1(halfSize + a, halfSize + b), m2(a, b));
+        }
+    }
+    floydWarshall(shared);
+
+    // the outer blocks start out as the operands, x and x'' are not related yet
+    res.Reset(baseSize);
+    auto& exits = scratch.exits;
+    exits.assign(std::size_t(halfSize) * res.Stride(), dm::INF);
+    for (int i = 0; i < halfSize; ++i)
+    {
+        std::copy_n(m1.Row(i), halfSize, res.Row(i));
+        std::copy_n(m2.Row(halfSize + i) + halfSize, halfSize, res.Row(halfSize + i) + halfSize);
+        // edges from shared variable i back to the outer variables
+        std::copy_n(m1.Row(halfSize + i), halfSize, exits.data() + std::size_t(i) * res.Stride());
+        std::copy_n(m2.Row(i) + halfSize, halfSize, exits.data() + std::size_t(i) * res.Stride() + halfSize);
+    }
+
+    // res[u] = min(res[u], min_a,b m(u, a) + shared*(a, b) + exits[b])
+    // every row u only writes res[u]
+    auto& entries = scratch.entries;
+    entries.resize(std::max<std::size_t>(entries.size(), scout::MatrixOperations::GetThreadCount()));
+    for (auto& rowEntries : entries)
+    {
+        rowEntries.resize(shared.Stride());
+    }
+    // a negative cycle among the shared variables does not make res empty, only one that reaches its diagonal does
+    std::atomic<bool> empty = false;
+    forRowBlocks(baseSize,
+                 [&](int begin, int end, int thread)
+                 {
+                     auto& rowEntries = entries[thread];
+                     for (int u = begin; u < end && !empty.load(std::memory_order_relaxed); ++u)
+                     {
+                         auto const* edges = u < halfSize ? m1.Row(u) + halfSize : m2.Row(u);
+                         std::fill(rowEntries.begin(), rowEntries.end(), dm::INF);
+                         for (int a = 0; a < halfSize; ++a)
+                         {
+                             if (edges[a] != dm::INF)
+                             {
+                                 relaxRow(rowEntries.data(), shared.Row(a), edges[a], shared.Stride());
+                             }
+                         }
+                         for (int b = 0; b < halfSize; ++b)
+                         {
+                             if (rowEntries[b] != dm::INF)
+                             {
+                                 relaxRow(res.Row(u), exits.data() + std::size_t(b) * res.Stride(), rowEntries[b], res.Stride());
+                             }
+                         }
+                         if (stopIfEmpty && res(u, u) < 0)
+                         {
+                             empty.store(true, std::memory_order_relaxed);
+                         }
+                     }
+                 });
+    if (empty)
+    {
+        return false;
+    }
+
+    if (tighten)
+    {
+        tightClosure(res, scratch);
+    }
+    if (stopIfEmpty)
+    {
+        for (int i = 0; i < baseSize; ++i)
+        {
+            if (res(i, i) < 0)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void scout::MatrixOperations::IntegerFloydWarshallAlgorithm(dense_matrix<std::int32_t>& m) { floydWarshall(m); }
+
+void scout::MatrixOperations::IntegerFloydWarshallAlgorithm(dense_matrix<std::int64_t>& m) { floydWarshall(m); }
+
+void scout::MatrixOperations::CalculateIntegerTightClosure(dense_matrix<std::int32_t>& m, dense_scratch<std::int32_t>& scratch) { tightClosure(m, scratch); }
+
+void scout::MatrixOperations::CalculateIntegerTightClosure(dense_matrix<std::int64_t>& m, dense_scratch<std::int64_t>& scratch) { tightClosure(m, scratch); }
+
+void scout::MatrixOperations::IntegerMatrixComposition(dense_matrix<std::int32_t> const& m1, dense_matrix<std::int32_t> const& m2, bool tighten,
+                                                      dense_matrix<std::int32_t>& res, dense_scratch<std::int32_t>& scratch)
+{
+    composeClosed(m1, m2, tighten, res, scratch, false);
+}
+
+void scout::MatrixOperations::IntegerMatrixComposition(dense_matrix<std::int64_t> const& m1, dense_matrix<std::int64_t> const& m2, bool tighten,
+                                                      dense_matrix<std::int64_t>& res, dense_scratch<std::int64_t>& scratch)
+{
+    composeClosed(m1, m2, tighten, res, scratch, false);
+}
+
+bool scout::MatrixOperations::ConsistentIntegerMatrixComposition(dense_matrix<std::int32_t> const& m1, dense_matrix<std::int32_t> const& m2, bool tighten,
+                                                                dense_matrix<std::int32_t>& res, dense_scratch<std::int32_t>& scratch)
+{
+    return composeClosed(m1, m2, tighten, res, scratch, true);
+}
+
+bool scout::MatrixOperations::ConsistentIntegerMatrixComposition(dense_matrix<std::int64_t> const& m1, dense_matrix<std::int64_t> const& m2, bool tighten,
+                                                                dense_matrix<std::int64_t>& res, dense_scratch<std::int64_t>& scratch)
+{
+    return composeClosed(m1, m2, tighten, res, scratch, true);
+}
+
+// ===============================================
+// half matrices
+
+// row[j] = min(row[j], ik + via[j]) for j < length, INF in via stays INF. ik has to be finite. Half rows are not
+// padded, so this is the plain loop of relaxRow.
+template <typename T>
+static void relaxPrefix(T* row, T const* via, T ik, int length)
+{
+    using dm = scout::dense_matrix<T>;
+    for (int j = 0; j < length; ++j)
+    {
+        auto kj = via[j];
+        auto candidate = kj == dm::INF ? dm::INF : dm::Saturate(ik + kj);
+        row[j] = std::min(row[j], candidate);
+    }
+}
+
+template <typename T>
+static T addPath(T a, T b)
+{
+    using dm = scout::dense_matrix<T>;
+    return a == dm::INF || b == dm::INF ? dm::INF : dm::Saturate(a + b);
+}
+
+// Floyd-Warshall that takes the variables' two rows 2k and 2k + 1 as pivots in one step, so every step keeps the matrix
+// coherent and only the stored half is relaxed. Gives the same shortest paths as floydWarshall.
+template <typename T>
+static void halfFloydWarshall(scout::half_matrix<T>& m, scout::half_scratch<T>& scratch)
+{
+    using dm = scout::dense_matrix<T>;
+    auto size = m.Size();
+    auto& viaEven = scratch.viaEven;
+    auto& viaOdd = scratch.viaOdd;
+    auto& columnEven = scratch.columnEven;
+    auto& columnOdd = scratch.columnOdd;
+    viaEven.resize(size);
+    viaOdd.resize(size);
+    columnEven.resize(size);
+    columnOdd.resize(size);
+    std::atomic<std::uint64_t> relaxations = 0;
+    for (int even = 0; even < size; even += 2)
+    {
+        auto odd = even + 1;
+        // paths from a pivot to j, possibly through the other pivot, and from i to the pivots; taken before the step,
+        // so the rows can be relaxed in any order
+        auto evenOdd = m(even, odd);
+        auto oddEven = m(odd, even);
+        for (int j = 0; j < size; ++j)
+        {
+            auto evenJ = m(even, j);
+            auto oddJ = m(odd, j);
+            viaEven[j] = std::min(evenJ, addPath(evenOdd, oddJ));
+            viaOdd[j] = std::min(oddJ, addPath(oddEven, evenJ));
+            columnEven[j] = m(j, even);
+            columnOdd[j] = m(j, odd);
+        }
+        forRowBlocks(size,
+                     [&](int begin, int end, int)
+                     {
+                         std::uint64_t cells = 0;
+                         for (int i = begin; i < end; ++i)
+                         {
+                             auto length = scout::half_matrix<T>::RowLength(i);
+                             if (columnEven[i] != dm::INF)
+                             {
+                                 relaxPrefix(m.Row(i), viaEven.data(), columnEven[i], length);
+                                 cells += length;
+                             }
+                             if (columnOdd[i] != dm::INF)
+                             {
+                                 relaxPrefix(m.Row(i), viaOdd.data(), columnOdd[i], length);
+                                 cells += length;
+                             }
+                         }
+                         if constexpr (scout::COLLECT_STATS)
+                         {
+                             relaxations.fetch_add(cells, std::memory_order_relaxed);
+                         }
+                     });
+    }
+    scout::RecordStats([&](scout::ClosureStats& stats) { stats.relaxations += relaxations.load(); });
+}
+
+// m[i][j] = min(m[i][j], HalfInt(m[i][i']) + HalfInt(m[j'][j])) like tightClosure, on the stored half
+template <typename T>
+static void halfTightClosure(scout::half_matrix<T>& m, scout::half_scratch<T>& scratch)
+{
+    using dm = scout::dense_matrix<T>;
+    auto size = m.Size();
+
+    // halves of m[j'][j]; the row halves m[i][i'] are read before row i is changed
+    auto& halves = scratch.halves;
+    halves.resize(size);
+    for (int j = 0; j < size; ++j)
+    {
+        auto value = m(j ^ 1, j);
+        halves[j] = value == dm::INF ? dm::INF : value >> 1;
+    }
+    forRowBlocks(size,
+                 [&](int begin, int end, int)
+                 {
+                     for (int i = begin; i < end; ++i)
+                     {
+                         auto value = m.Row(i)[i ^ 1];
+                         if (value != dm::INF)
+                         {
+                             relaxPrefix(m.Row(i), halves.data(), T(value >> 1), scout::half_matrix<T>::RowLength(i));
+                         }
+                     }
+                 });
+}
+
+// composeClosed for coherent operands: the shared block is closed as a half matrix and only the stored half of the
+// result is relaxed
+template <typename T>
+static void halfComposeClosed(scout::half_matrix<T> const& m1, scout::half_matrix<T> const& m2, bool tighten, scout::half_matrix<T>& res,
+                              scout::half_scratch<T>& scratch)
+{
+    using dm = scout::dense_matrix<T>;
+    auto baseSize = m1.Size();
+    auto halfSize = baseSize / 2;
+
+    auto& shared = scratch.shared;
+    shared.Reset(halfSize);
+    for (int a = 0; a < halfSize; ++a)
+    {
+        for (int b = 0; b < scout::half_matrix<T>::RowLength(a); ++b)
+        {
+            shared.Row(a)[b] = std::min(m1(halfSize + a, halfSize + b), m2(a, b));
+        }
+    }
+    halfFloydWarshall(shared, scratch);
+
+    // the closed shared block as full rows, and the edges from shared variable b back to the outer variables
+    auto& sharedRows = scratch.sharedRows;
+    auto& exits = scratch.exits;
+    sharedRows.resize(std::size_t(halfSize) * halfSize);
+    exits.resize(std::size_t(halfSize) * baseSize);
+    for (int a = 0; a < halfSize; ++a)
+    {
+        for (int b = 0; b < halfSize; ++b)
+        {
+            sharedRows[std::size_t(a) * halfSize + b] = shared(a, b);
+        }
+        for (int v = 0; v < baseSize; ++v)
+        {
+            exits[std::size_t(a) * baseSize + v] = v < halfSize ? m1(halfSize + a, v) : m2(a, v);
+        }
+    }
+
+    // the outer blocks start out as the operands, x'' and x are not related yet
+    res.Reset(baseSize);
+    for (int u = 0; u < baseSize; ++u)
+    {
+        auto* row = res.Row(u);
+        for (int v = 0; v < scout::half_matrix<T>::RowLength(u); ++v)
+        {
+            if (u < halfSize)
+            {
+                row[v] = m1(u, v);
+            }
+            else if (v >= halfSize)
+            {
+                row[v] = m2(u, v);
+            }
+        }
+    }
+
+    // one row of edges into the shared variables and one of entries per thread
+    auto& entries = scratch.entries;
+    entries.resize(std::max<std::size_t>(entries.size(), scout::MatrixOperations::GetThreadCount()));
+    for (auto& rowEntries : entries)
+    {
+        rowEntries.resize(2 * std::size_t(halfSize));
+    }
+    forRowBlocks(baseSize,
+                 [&](int begin, int end, int thread)
+                 {
+                     auto* edges = entries[thread].data();
+                     auto* rowEntries = edges + halfSize;
+                     for (int u = begin; u < end; ++u)
+                     {
+                         for (int a = 0; a < halfSize; ++a)
+                         {
+                             edges[a] = u < halfSize ? m1(u, halfSize + a) : m2(u, a);
+                         }
+                         std::fill_n(rowEntries, halfSize, dm::INF);
+                         for (int a = 0; a < halfSize; ++a)
+                         {
+                             if (edges[a] != dm::INF)
+                             {
+                                 relaxPrefix(rowEntries, sharedRows.data() + std::size_t(a) * halfSize, edges[a], halfSize);
+                             }
+                         }
+                         for (int b = 0; b < halfSize; ++b)
+                         {
+                             if (rowEntries[b] != dm::INF)
+                             {
+                                 relaxPrefix(res.Row(u), exits.data() + std::size_t(b) * baseSize, rowEntries[b], scout::half_matrix<T>::RowLength(u));
+                             }
+                         }
+                     }
+                 });
+
+    if (tighten)
+    {
+        halfTightClosure(res, scratch);
+    }
+}
+
+void scout::MatrixOperations::OctagonalFloydWarshallAlgorithm(half_matrix<std::int32_t>& m, half_scratch<std::int32_t>& scratch) { halfFloydWarshall(m, scratch); }
+
+void scout::MatrixOperations::OctagonalFloydWarshallAlgorithm(half_matrix<std::int64_t>& m, half_scratch<std::int64_t>& scratch) { halfFloydWarshall(m, scratch); }
+
+void scout::MatrixOperations::CalculateOctagonalTightClosure(half_matrix<std::int32_t>& m, half_scratch<std::int32_t>& scratch) { halfTightClosure(m, scratch); }
+
+void scout::MatrixOperations::CalculateOctagonalTightClosure(half_matrix<std::int64_t>& m, half_scratch<std::int64_t>& scratch) { halfTightClosure(m, scratch); }
+
+void scout::MatrixOperations::OctagonalMatrixComposition(half_matrix<std::int32_t> const& m1, half_matrix<std::int32_t> const& m2, bool tighten,
+                                                        half_matrix<std::int32_t>& res, half_scratch<std::int32_t>& scratch)
+{
+    halfComposeClosed(m1, m2, tighten, res, scratch);
+}
+
+void scout::MatrixOperations::OctagonalMatrixComposition(half_matrix<std::int64_t> const& m1, half_matrix<std::int64_t> const& m2, bool tighten,
+                                                        half_matrix<std::int64_t>& res, half_scratch<std::int64_t>& scratch)
+{
+    halfComposeClosed(m1, m2, tighten, res, scratch);
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "Common.hpp"
+#include "Matrix.hpp"
+
+namespace scout
+{
+// Dense integer DBM for matrices without parametric terms. An empty cell is stored as INF, finite values saturate at
+// +-MAX_FINITE so that adding two of them never overflows. Rows are padded to 64 bytes with INF, which lets the kernels
+// run over whole vector registers.
+template <typename T>
+class dense_matrix
+{
+public:
+    static constexpr T INF = std::numeric_limits<T>::max();
+    static constexpr T MAX_FINITE = INF / 2;
+    static constexpr T MIN_FINITE = -MAX_FINITE;
+    static constexpr int LANES = 64 / sizeof(T);
+
+    dense_matrix() = default;
+
+    explicit dense_matrix(int size) { Reset(size); }
+
+    // m has to satisfy MatrixOperations::IsNonParametric
+    explicit dense_matrix(matrix const& m) { Load(m); }
+
+    // turns this into a matrix of the given size with all cells INF, keeping the allocated storage
+    void Reset(int size)
+    {
+        this->size = size;
+        stride = (size + LANES - 1) / LANES * LANES;
+        values.assign(std::size_t(size) * stride, INF);
+    }
+
+    // m has to satisfy MatrixOperations::IsNonParametric
+    void Load(matrix const& m)
+    {
+        Reset(m.Size());
+        for (int i = 0; i < size; ++i)
+        {
+            for (int j = 0; j < size; ++j)
+            {
+                auto c = m(i, j);
+                if (!c.empty())
+                {
+                    (*this)(i, j) = Saturate(c[0].second);
+                }
+            }
+        }
+    }
+
+    // writes the cells into m, which is resized to this size if necessary. Cells only hold single terms, so storing
+    // into a matrix that already has this size does not allocate.
+    void Store(matrix& m) const
+    {
+        if (m.Size() != size)
+        {
+            m.Reset(size);
+        }
+        for (int i = 0; i < size; ++i)
+        {
+            for (int j = 0; j < size; ++j)
+            {
+                auto value = (*this)(i, j);
+                if (value == INF)
+                {
+                    m.Clear(i, j);
+                    continue;
+                }
+                m.Assign(i, j, {term(0, ClampTerm(value))});
+            }
+        }
+    }
+
+    [[nodiscard]] int Size() const { return size; }
+
+    [[nodiscard]] int Stride() const { return stride; }
+
+    [[nodiscard]] T* Row(int i) { return values.data() + std::size_t(i) * stride; }
+
+    [[nodiscard]] T const* Row(int i) const { return values.data() + std::size_t(i) * stride; }
+
+    [[nodiscard]] T& operator()(int i, int j) { return Row(i)[j]; }
+
+    [[nodiscard]] T operator()(int i, int j) const { return Row(i)[j]; }
+
+    [[nodiscard]] matrix ToMatrix() const
+    {
+        matrix m(size);
+        Store(m);
+        return m;
+    }
+
+    static T Saturate(T value) { return std::clamp(value, MIN_FINITE, MAX_FINITE); }
+
+private:
+    int size = 0;
+    int stride = 0;
+    counted_vector<T> values;
+};
+
+// buffers of the dense kernels that can be kept from one call to the next
+template <typename T>
+struct dense_scratch
+{
+    dense_matrix<T> shared;
+    counted_vector<T> exits;
+    // one row of entries per thread
+    counted_vector<counted_vector<T>> entries;
+    counted_vector<T> halves;
+};
+} // namespace scout
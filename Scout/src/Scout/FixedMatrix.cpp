@@ -0,0 +1,211 @@
+#include "FixedMatrix.hpp"
+#include "MatrixOperations.hpp"
+#include "Stats.hpp"
+
+#include <utility>
+
+// The dense kernels of DenseMatrix.cpp for a size known at compile time. They relax in the same order and saturate the
+// same way, so they give the same matrices; with N constant the compiler unrolls and vectorizes the row loops.
+
+// rowI[j] = min(rowI[j], ik + rowK[j]) for all j, INF in rowK stays INF. ik has to be finite.
+template <typename T, int N>
+static void relaxRow(T* rowI, T const* rowK, T ik)
+{
+    using dm = scout::dense_matrix<T>;
+    for (int j = 0; j < N; ++j)
+    {
+        auto kj = rowK[j];
+        auto candidate = kj == dm::INF ? dm::INF : dm::Saturate(ik + kj);
+        rowI[j] = std::min(rowI[j], candidate);
+    }
+}
+
+template <typename T, int N>
+static void floydWarshall(scout::fixed_matrix<T, N>& m)
+{
+    std::uint64_t relaxedRows = 0;
+    for (int k = 0; k < N; ++k)
+    {
+        auto const* rowK = m.Row(k);
+        for (int i = 0; i < N; ++i)
+        {
+            auto ik = m(i, k);
+            if (i == k || ik == scout::dense_matrix<T>::INF)
+            {
+                continue;
+            }
+            relaxRow<T, N>(m.Row(i), rowK, ik);
+            // like the parametric version, column k is not relaxed through itself
+            m(i, k) = ik;
+            ++relaxedRows;
+        }
+    }
+    scout::RecordStats([&](scout::ClosureStats& stats) { stats.relaxations += relaxedRows * std::uint64_t(N); });
+}
+
+template <typename T, int N>
+static void tightClosure(scout::fixed_matrix<T, N>& m)
+{
+    using dm = scout::dense_matrix<T>;
+    // halves of m[j'][j]; the row halves m[i][i'] are read before row i is changed
+    std::array<T, N> halves;
+    for (int j = 0; j < N; ++j)
+    {
+        auto value = m(scout::MatrixOperations::IDash(j), j);
+        halves[j] = value == dm::INF ? dm::INF : value >> 1;
+    }
+    for (int i = 0; i < N; ++i)
+    {
+        auto value = m(i, scout::MatrixOperations::IDash(i));
+        if (value != dm::INF)
+        {
+            relaxRow<T, N>(m.Row(i), halves.data(), T(value >> 1));
+        }
+    }
+}
+
+template <typename T, int N>
+static bool hasNegativeCycle(scout::fixed_matrix<T, N> const& m)
+{
+    for (int i = 0; i < N; ++i)
+    {
+        if (m(i, i) < 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// false if the shared block or res has a negative cycle, see ComposeFixedSize
+template <typename T, int N>
+static bool composeClosed(scout::fixed_matrix<T, N> const& m1, scout::fixed_matrix<T, N> const& m2, bool tighten, scout::fixed_matrix<T, N>& res)
+{
+    using dm = scout::dense_matrix<T>;
+    constexpr int H = N / 2;
+
+    // see composeClosed in DenseMatrix.cpp: close the shared block, then relax the outer rows through it
+    scout::fixed_matrix<T, H> shared;
+    for (int a = 0; a < H; ++a)
+    {
+        for (int b = 0; b < H; ++b)
+        {
+            shared(a, b) = std::min(m1(H + a, H + b), m2(a, b));
+        }
+    }
+    floydWarshall(shared);
+    if (hasNegativeCycle(shared))
+    {
+        return false;
+    }
+
+    scout::fixed_matrix<T, N> exits;
+    for (int i = 0; i < H; ++i)
+    {
+        std::copy_n(m1.Row(i), H, res.Row(i));
+        std::copy_n(m2.Row(H + i) + H, H, res.Row(H + i) + H);
+        std::copy_n(m1.Row(H + i), H, exits.Row(i));
+        std::copy_n(m2.Row(i) + H, H, exits.Row(i) + H);
+    }
+
+    std::array<T, H> entries;
+    for (int u = 0; u < N; ++u)
+    {
+        auto const* edges = u < H ? m1.Row(u) + H : m2.Row(u);
+        entries.fill(dm::INF);
+        for (int a = 0; a < H; ++a)
+        {
+            if (edges[a] != dm::INF)
+            {
+                relaxRow<T, H>(entries.data(), shared.Row(a), edges[a]);
+            }
+        }
+        for (int b = 0; b < H; ++b)
+        {
+            if (entries[b] != dm::INF)
+            {
+                relaxRow<T, N>(res.Row(u), exits.Row(b), entries[b]);
+            }
+        }
+    }
+
+    if (tighten)
+    {
+        tightClosure(res);
+    }
+    return !hasNegativeCycle(res);
+}
+
+template <int N>
+static void closeFixed(scout::matrix& m, bool tighten)
+{
+    scout::fixed_matrix<std::int32_t, N> dense;
+    dense.Load(m);
+    floydWarshall(dense);
+    if (tighten)
+    {
+        tightClosure(dense);
+    }
+    dense.Store(m);
+}
+
+template <int N>
+static bool composeFixed(scout::matrix& result, scout::matrix const& m1, scout::matrix const& m2, bool tighten)
+{
+    scout::fixed_matrix<std::int32_t, N> dense1;
+    scout::fixed_matrix<std::int32_t, N> dense2;
+    scout::fixed_matrix<std::int32_t, N> res;
+    dense1.Load(m1);
+    dense2.Load(m2);
+    if (!composeClosed(dense1, dense2, tighten, res))
+    {
+        return false;
+    }
+    res.Store(result);
+    return true;
+}
+
+// the specializations for size 2 * (index + 1)
+struct fixed_kernels
+{
+    void (*close)(scout::matrix&, bool);
+    bool (*compose)(scout::matrix&, scout::matrix const&, scout::matrix const&, bool);
+};
+
+template <std::size_t... Index>
+static constexpr std::array<fixed_kernels, sizeof...(Index)> makeFixedKernels(std::index_sequence<Index...>)
+{
+    return {fixed_kernels{&closeFixed<2 * int(Index + 1)>, &composeFixed<2 * int(Index + 1)>}...};
+}
+
+static constexpr auto FIXED_KERNELS = makeFixedKernels(std::make_index_sequence<scout::MatrixOperations::FIXED_MAX_SIZE / 2>());
+
+static fixed_kernels const* fixedKernels(int size)
+{
+    if (size < 2 || size > scout::MatrixOperations::FIXED_MAX_SIZE || size % 2 != 0)
+    {
+        return nullptr;
+    }
+    return &FIXED_KERNELS[size / 2 - 1];
+}
+
+bool scout::MatrixOperations::CloseFixedSize(matrix& m, bool tighten)
+{
+    auto const* kernels = fixedKernels(m.Size());
+    if (kernels == nullptr)
+    {
+        return false;
+    }
+    kernels->close(m, tighten);
+    return true;
+}
+
+bool scout::MatrixOperations::ComposeFixedSize(matrix& result, matrix const& m1, matrix const& m2, bool tighten)
+{
+    auto const* kernels = fixedKernels(m1.Size());
+    if (kernels == nullptr)
+    {
+        return false;
+    }
+    return kernels->compose(result, m1, m2, tighten);
+}
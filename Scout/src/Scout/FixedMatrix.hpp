@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+
+#include "Common.hpp"
+#include "DenseMatrix.hpp"
+#include "Matrix.hpp"
+
+namespace scout
+{
+// dense_matrix with the size fixed at compile time, held in a std::array so that small matrices live on the stack and
+// every loop over a row has a constant trip count. Same INF and saturation as dense_matrix, without row padding.
+template <typename T, int N>
+class fixed_matrix
+{
+public:
+    static constexpr T INF = dense_matrix<T>::INF;
+    static constexpr int SIZE = N;
+
+    fixed_matrix() { values.fill(INF); }
+
+    // m has to satisfy MatrixOperations::IsNonParametric and have N rows
+    void Load(matrix const& m)
+    {
+        for (int i = 0; i < N; ++i)
+        {
+            for (int j = 0; j < N; ++j)
+            {
+                auto c = m(i, j);
+                (*this)(i, j) = c.empty() ? INF : dense_matrix<T>::Saturate(c[0].second);
+            }
+        }
+    }
+
+    // like dense_matrix::Store
+    void Store(matrix& m) const
+    {
+        if (m.Size() != N)
+        {
+            m.Reset(N);
+        }
+        for (int i = 0; i < N; ++i)
+        {
+            for (int j = 0; j < N; ++j)
+            {
+                auto value = (*this)(i, j);
+                if (value == INF)
+                {
+                    m.Clear(i, j);
+                    continue;
+                }
+                m.Assign(i, j, {term(0, ClampTerm(value))});
+            }
+        }
+    }
+
+    [[nodiscard]] T* Row(int i) { return values.data() + i * N; }
+
+    [[nodiscard]] T const* Row(int i) const { return values.data() + i * N; }
+
+    [[nodiscard]] T& operator()(int i, int j) { return values[i * N + j]; }
+
+    [[nodiscard]] T operator()(int i, int j) const { return values[i * N + j]; }
+
+private:
+    std::array<T, std::size_t(N) * N> values;
+};
+} // namespace scout
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+#include "Common.hpp"
+#include "DenseMatrix.hpp"
+#include "Matrix.hpp"
+
+namespace scout
+{
+// Dense integer octagon that only stores the cells (i, j) with j <= i | 1. The other half follows from coherence,
+// m(i, j) == m(j', i') with i' = IDash(i), which every octagon satisfies. Row i holds (i | 1) + 1 cells and starts at
+// (i + 1)^2 / 2, so a matrix of size 2n takes 2n^2 + 2n values instead of 4n^2. INF and saturation as in dense_matrix.
+template <typename T>
+class half_matrix
+{
+public:
+    static constexpr T INF = dense_matrix<T>::INF;
+
+    half_matrix() = default;
+
+    explicit half_matrix(int size) { Reset(size); }
+
+    // turns this into a matrix of the given even size with all cells INF, keeping the allocated storage
+    void Reset(int size)
+    {
+        this->size = size;
+        values.assign(RowOffset(size), INF);
+    }
+
+    // m has to be coherent (MatrixOperations::IsCoherent) and satisfy MatrixOperations::IsNonParametric
+    void Load(matrix const& m)
+    {
+        Reset(m.Size());
+        for (int i = 0; i < size; ++i)
+        {
+            auto* row = Row(i);
+            for (int j = 0; j < RowLength(i); ++j)
+            {
+                auto c = m(i, j);
+                if (!c.empty())
+                {
+                    row[j] = dense_matrix<T>::Saturate(c[0].second);
+                }
+            }
+        }
+    }
+
+    // writes both halves into m, see dense_matrix::Store
+    void Store(matrix& m) const
+    {
+        if (m.Size() != size)
+        {
+            m.Reset(size);
+        }
+        for (int i = 0; i < size; ++i)
+        {
+            for (int j = 0; j < size; ++j)
+            {
+                auto value = (*this)(i, j);
+                if (value == INF)
+                {
+                    m.Clear(i, j);
+                    continue;
+                }
+                m.Assign(i, j, {term(0, ClampTerm(value))});
+            }
+        }
+    }
+
+    [[nodiscard]] int Size() const { return size; }
+
+    [[nodiscard]] static std::size_t RowOffset(int i) { return std::size_t(i + 1) * std::size_t(i + 1) / 2; }
+
+    [[nodiscard]] static int RowLength(int i) { return (i | 1) + 1; }
+
+    // the stored cells (i, 0) to (i, i | 1)
+    [[nodiscard]] T* Row(int i) { return values.data() + RowOffset(i); }
+
+    [[nodiscard]] T const* Row(int i) const { return values.data() + RowOffset(i); }
+
+    // any cell, the upper half is read through coherence
+    [[nodiscard]] T operator()(int i, int j) const { return j <= (i | 1) ? Row(i)[j] : Row(j ^ 1)[i ^ 1]; }
+
+    // the stored cell that (i, j) is the same as
+    [[nodiscard]] T& At(int i, int j) { return j <= (i | 1) ? Row(i)[j] : Row(j ^ 1)[i ^ 1]; }
+
+private:
+    int size = 0;
+    counted_vector<T> values;
+};
+
+// buffers of the half matrix kernels that can be kept from one call to the next
+template <typename T>
+struct half_scratch
+{
+    // rows and columns of the two pivots of a step of the closure
+    counted_vector<T> viaEven;
+    counted_vector<T> viaOdd;
+    counted_vector<T> columnEven;
+    counted_vector<T> columnOdd;
+    // HalfInt of m(i, i') for the tight closure
+    counted_vector<T> halves;
+
+    // composition: the shared variables closed and unfolded to full rows, and the edges back to the outer variables
+    half_matrix<T> shared;
+    counted_vector<T> sharedRows;
+    counted_vector<T> exits;
+    // one row of entries per thread
+    counted_vector<counted_vector<T>> entries;
+};
+} // namespace scout
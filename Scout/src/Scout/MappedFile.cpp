@@ -0,0 +1,59 @@
+#include "MappedFile.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SCOUT_HAS_MMAP 1
+#endif
+
+scout::MappedFile::MappedFile(std::string const& path)
+{
+#ifdef SCOUT_HAS_MMAP
+    auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::invalid_argument("No such File exists");
+    }
+    struct stat status{};
+    if (::fstat(fd, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0)
+    {
+        auto* address = ::mmap(nullptr, std::size_t(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED)
+        {
+            data = static_cast<char const*>(address);
+            size = std::size_t(status.st_size);
+            mapped = true;
+        }
+    }
+    ::close(fd);
+    if (mapped)
+    {
+        return;
+    }
+#endif
+    // pipes, empty files and platforms without mmap
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        throw std::invalid_argument("No such File exists");
+    }
+    buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    data = buffer.data();
+    size = buffer.size();
+}
+
+scout::MappedFile::~MappedFile()
+{
+#ifdef SCOUT_HAS_MMAP
+    if (mapped)
+    {
+        ::munmap(const_cast<char*>(data), size);
+    }
+#endif
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace scout
+{
+// Read-only contents of a file. Regular files are memory mapped where the platform supports it, everything else is read
+// into a buffer once.
+class MappedFile
+{
+public:
+    explicit MappedFile(std::string const& path);
+    ~MappedFile();
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    // valid for the lifetime of the MappedFile
+    [[nodiscard]] std::string_view Text() const { return {data, size}; }
+
+private:
+    char const* data = nullptr;
+    std::size_t size = 0;
+    bool mapped = false;
+    std::string buffer;
+};
+} // namespace scout
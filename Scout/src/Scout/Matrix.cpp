@@ -0,0 +1,160 @@
+#include "Matrix.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+
+scout::matrix::matrix(int size)
+{
+    Reset(size);
+    RecordStats([](ClosureStats& stats) { ++stats.matricesAllocated; });
+}
+
+scout::matrix::matrix(matrix const& other) : size(other.size), slots(other.slots), arena(other.arena), unusedTerms(other.unusedTerms)
+{
+    RecordStats([](ClosureStats& stats) { ++stats.matricesAllocated; });
+}
+
+void scout::matrix::Reset(int size)
+{
+    this->size = size;
+    slots.resize(std::size_t(size) * size);
+    for (std::uint32_t i = 0; i < slots.size(); ++i)
+    {
+        slots[i] = {i, 0, 1};
+    }
+    arena.resize(slots.size());
+    unusedTerms = 0;
+}
+
+void scout::matrix::Reset(int size, std::span<std::uint32_t const> lengths, cell_view terms)
+{
+    this->size = size;
+    slots.resize(std::size_t(size) * size);
+    std::uint32_t offset = 0;
+    for (std::size_t i = 0; i < slots.size(); ++i)
+    {
+        slots[i] = {offset, lengths[i], lengths[i]};
+        offset += lengths[i];
+    }
+    arena.assign(terms.begin(), terms.end());
+    unusedTerms = 0;
+}
+
+void scout::matrix::Assign(int i, int j, cell_view terms)
+{
+    auto& s = slots[i * size + j];
+    auto length = std::uint32_t(terms.size());
+    if (length > s.capacity)
+    {
+        auto aliasesArena = !terms.empty() && std::less_equal<>{}(arena.data(), terms.data()) && std::less<>{}(terms.data(), arena.data() + arena.size());
+        if (aliasesArena)
+        {
+            // growing the arena would invalidate terms
+            cell copy(terms.begin(), terms.end());
+            Assign(i, j, copy);
+            return;
+        }
+        Relocate(s, std::bit_ceil(length));
+    }
+    std::copy(terms.begin(), terms.end(), arena.begin() + s.offset);
+    s.length = length;
+
+    if (unusedTerms > arena.size() / 2)
+    {
+        Compact();
+    }
+}
+
+void scout::matrix::Assign(int i, int j, std::initializer_list<term> terms) { Assign(i, j, cell_view(terms.begin(), terms.size())); }
+
+std::size_t scout::matrix::MemoryUsage() const
+{
+    return slots.capacity() * sizeof(slot) + (arena.capacity() + spareArena.capacity()) * sizeof(term);
+}
+
+std::size_t scout::matrix::TermCount() const
+{
+    std::size_t count = 0;
+    for (auto const& s : slots)
+    {
+        count += s.length;
+    }
+    return count;
+}
+
+std::size_t scout::matrix::MaxCellLength() const
+{
+    std::uint32_t length = 0;
+    for (auto const& s : slots)
+    {
+        length = std::max(length, s.length);
+    }
+    return length;
+}
+
+bool scout::matrix::TryAssign(int i, int j, cell_view terms)
+{
+    auto& s = slots[i * size + j];
+    if (terms.size() > s.capacity)
+    {
+        return false;
+    }
+    std::copy(terms.begin(), terms.end(), arena.begin() + s.offset);
+    s.length = std::uint32_t(terms.size());
+    return true;
+}
+
+void scout::matrix::Append(int i, int j, term t)
+{
+    auto& s = slots[i * size + j];
+    if (s.length == s.capacity)
+    {
+        Relocate(s, std::max<std::uint32_t>(2 * s.capacity, 1));
+    }
+    arena[s.offset + s.length] = t;
+    ++s.length;
+}
+
+bool scout::matrix::operator==(matrix const& other) const
+{
+    if (size != other.size)
+    {
+        return false;
+    }
+    for (int i = 0; i < size; ++i)
+    {
+        for (int j = 0; j < size; ++j)
+        {
+            if (!std::ranges::equal((*this)(i, j), other(i, j)))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void scout::matrix::Relocate(slot& s, std::uint32_t capacity)
+{
+    auto offset = std::uint32_t(arena.size());
+    arena.resize(arena.size() + capacity);
+    std::copy_n(arena.begin() + s.offset, s.length, arena.begin() + offset);
+    unusedTerms += s.capacity;
+    s.offset = offset;
+    s.capacity = capacity;
+}
+
+void scout::matrix::Compact()
+{
+    spareArena.reserve(arena.size() - unusedTerms);
+    for (auto& s : slots)
+    {
+        auto offset = std::uint32_t(spareArena.size());
+        spareArena.insert(spareArena.end(), arena.begin() + s.offset, arena.begin() + s.offset + s.capacity);
+        s.offset = offset;
+    }
+    arena.swap(spareArena);
+    spareArena.clear();
+    unusedTerms = 0;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "Common.hpp"
+#include "Stats.hpp"
+
+namespace scout
+{
+// Square matrix of cells. The terms of all cells live in one contiguous arena, every cell only stores offset, length and
+// capacity of its terms. A fresh matrix reserves one term per cell in row-major order, so single-term cells never allocate.
+class matrix
+{
+public:
+    matrix() = default;
+    explicit matrix(int size);
+
+    matrix(matrix const& other);
+    matrix(matrix&& other) noexcept = default;
+    matrix& operator=(matrix const& other) = default;
+    matrix& operator=(matrix&& other) noexcept = default;
+
+    // turns this into an empty matrix of the given size, keeping the allocated storage
+    void Reset(int size);
+
+    // turns this into a matrix whose cells, in row-major order, have the given lengths and take their terms one after the
+    // other from terms
+    void Reset(int size, std::span<std::uint32_t const> lengths, cell_view terms);
+
+    [[nodiscard]] int Size() const { return size; }
+
+    // bytes held by the slots and the arena
+    [[nodiscard]] std::size_t MemoryUsage() const;
+
+    // number of terms over all cells, and the length of the longest cell
+    [[nodiscard]] std::size_t TermCount() const;
+    [[nodiscard]] std::size_t MaxCellLength() const;
+
+    // views stay valid until the next Assign or Append on this matrix
+    [[nodiscard]] cell_view operator()(int i, int j) const
+    {
+        auto const& s = slots[i * size + j];
+        return {arena.data() + s.offset, s.length};
+    }
+
+    [[nodiscard]] std::span<term> operator()(int i, int j)
+    {
+        auto const& s = slots[i * size + j];
+        return {arena.data() + s.offset, s.length};
+    }
+
+    // replaces all terms of cell (i, j)
+    void Assign(int i, int j, cell_view terms);
+    void Assign(int i, int j, std::initializer_list<term> terms);
+
+    // Assign that only succeeds if terms fit the room already reserved for (i, j). It never changes the arena layout, so
+    // calls on distinct cells may run concurrently.
+    bool TryAssign(int i, int j, cell_view terms);
+
+    void Append(int i, int j, term t);
+
+    void Clear(int i, int j) { slots[i * size + j].length = 0; }
+
+    bool operator==(matrix const& other) const;
+
+private:
+    struct slot
+    {
+        std::uint32_t offset;
+        std::uint32_t length;
+        std::uint32_t capacity;
+    };
+
+    // moves the terms of s to the end of the arena and reserves room for capacity terms
+    void Relocate(slot& s, std::uint32_t capacity);
+
+    // drops the terms abandoned by Relocate
+    void Compact();
+
+    int size = 0;
+    counted_vector<slot> slots;
+    cell arena;
+    // empty between calls of Compact, which builds the new arena in it to reuse its storage
+    cell spareArena;
+    std::size_t unusedTerms = 0;
+};
+
+// a closed matrix that is no longer changed, shared by the power cache, the transitive closure and callers
+typedef std::shared_ptr<matrix const> shared_matrix;
+} // namespace scout
@@ -1,9 +1,16 @@
 #include "MatrixOperations.hpp"
+#include "Stats.hpp"
 
-#include <chrono>
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
 
-static bool isTerm1DominatedBy2(int a1, int b1, int a2, int b2)
+static bool isTerm1DominatedBy2(scout::term_value a1, scout::term_value b1, scout::term_value a2, scout::term_value b2)
 {
     if (b1 < b2)
         return false; // for x = 0, term 1 is smaller than 2
@@ -14,239 +21,501 @@ static bool isTerm1DominatedBy2(int a1, int b1, int a2, int b2)
     return true;
 }
 
-static void updateCellWithTerm(scout::cell& c, int a_new, int b_new)
+static bool isTermDominatedByCell(scout::term t, scout::cell_view c)
 {
-    // 1. check if (a_new, b_new) is minterm
-    for (auto& [a, b] : c)
+    return std::ranges::any_of(c, [t](scout::term v) { return isTerm1DominatedBy2(t.first, t.second, v.first, v.second); });
+}
+
+// appends the terms of current that no term of front dominates, followed by the terms of front that no term of current
+// dominates. front has to satisfy ReduceToMinTerms. This is the result of inserting the terms of front one after the
+// other into current, dropping a new term if an old one dominates it and the old terms the new one dominates.
+static void mergeMinTerms(scout::cell_view current, scout::cell const& front, scout::cell& currentFront, scout::cell& out)
+{
+    // the term with the largest alpha <= a has the smallest beta among all terms with alpha <= a
+    auto minBetaUpTo = [](scout::cell const& sorted, scout::term_value a) -> std::optional<scout::term_value>
     {
-        if (isTerm1DominatedBy2(a_new, b_new, a, b))
+        auto it = std::upper_bound(sorted.begin(), sorted.end(), a, [](scout::term_value value, scout::term t) { return value < t.first; });
+        if (it == sorted.begin())
         {
-            return;
+            return std::nullopt;
         }
+        return std::prev(it)->second;
+    };
+
+    if (current.empty())
+    {
+        out.assign(front.begin(), front.end());
+        return;
     }
-    // 2. remove all previous terms that are not min now
-    auto is_non_min = [a_new, b_new](std::pair<int, int> v) -> bool
+    currentFront.assign(current.begin(), current.end());
+    scout::MatrixOperations::ReduceToMinTerms(currentFront);
+
+    out.clear();
+    auto newBegin = std::ptrdiff_t(current.size());
+    for (auto t : current)
     {
-        auto [a, b] = v;
-        return isTerm1DominatedBy2(a, b, a_new, b_new);
-    };
-    c.erase(std::remove_if(c.begin(), c.end(), is_non_min), c.end());
+        out.emplace_back(t);
+    }
+    for (auto t : front)
+    {
+        auto beta = minBetaUpTo(currentFront, t.first);
+        if (!beta || *beta > t.second)
+        {
+            out.emplace_back(t);
+        }
+    }
 
-    // 3. actuall add term
-    c.emplace_back(a_new, b_new);
+    // the new terms are a sorted front as well, so the same lookup tells which old terms they dominate
+    currentFront.assign(out.begin() + newBegin, out.end());
+    auto kept = std::remove_if(out.begin(), out.begin() + newBegin,
+                               [&](scout::term t)
+                               {
+                                   auto beta = minBetaUpTo(currentFront, t.first);
+                                   return beta && *beta <= t.second;
+                               });
+    out.erase(kept, out.begin() + newBegin);
 }
-scout::matrix scout::MatrixOperations::ParametricFloydWarshallAlgorithm(matrix m, bool tighten)
+
+static std::mutex poolMutex;
+static std::unique_ptr<scout::ThreadPool> pool;
+
+void scout::MatrixOperations::SetThreadCount(int threads)
 {
-    auto size = int(m.size());
+    if (threads < 1)
+    {
+        throw std::invalid_argument("Thread count has to be positive");
+    }
+    std::lock_guard lock(poolMutex);
+    if (!pool || pool->Size() != threads)
+    {
+        pool = std::make_unique<ThreadPool>(threads);
+    }
+}
 
-    cell tmp;
+int scout::MatrixOperations::GetThreadCount() { return GetThreadPool().Size(); }
 
-    auto t0 = std::chrono::high_resolution_clock::now();
-    for (int k = 0; k < size; ++k)
+scout::ThreadPool& scout::MatrixOperations::GetThreadPool()
+{
+    std::lock_guard lock(poolMutex);
+    if (!pool)
     {
-        for (int i = 0; i < size; ++i)
+        pool = std::make_unique<ThreadPool>(1);
+    }
+    return *pool;
+}
+
+// MinTerms into a reused cell
+static void minTermsInto(scout::cell& minTerms, scout::cell_view c1, scout::cell_view c2, scout::cell_view c3)
+{
+    minTerms.assign(c1.begin(), c1.end());
+    for (auto termInCell2 : c2)
+    {
+        for (auto termInCell3 : c3)
         {
-            for (int j = 0; j < size; ++j)
+            minTerms.emplace_back(scout::TermSum(termInCell2.first, termInCell3.first), scout::TermSum(termInCell2.second, termInCell3.second));
+        }
+    }
+    scout::MatrixOperations::ReduceToMinTerms(minTerms);
+}
+
+// HalfTerms into a reused cell
+static void halfTermsInto(scout::cell& halfTerms, scout::cell_view c)
+{
+    halfTerms.clear();
+    for (auto term : c)
+    {
+        halfTerms.emplace_back(scout::MatrixOperations::HalfInt(term.first), scout::MatrixOperations::HalfInt(term.second));
+    }
+}
+
+// relaxes the cell current through c2 (the terms of m(i, k)) and c3 = m(k, j). Returns false if current stays as it is,
+// otherwise the new terms are left in s.tmp2.
+static bool relaxCell(scout::closure_scratch& s, scout::cell_view c3, scout::cell_view current)
+{
+    auto& tmp = s.tmp;
+    auto& c1 = s.c1;
+    auto& tmp2 = s.tmp2;
+
+    tmp.clear();
+    for (auto [a2, b2] : s.c2)
+    {
+        for (auto [a3, b3] : c3)
+        {
+            tmp.emplace_back(scout::TermSum(a2, a3), scout::TermSum(b2, b3));
+        }
+    }
+    if (tmp.empty())
+    {
+        return false;
+    }
+
+    // the cell stays untouched if no new term is a minterm and it is too small for the verification below
+    if (current.size() < 3 && std::ranges::all_of(tmp, [current](scout::term t) { return isTermDominatedByCell(t, current); }))
+    {
+        return false;
+    }
+
+    scout::MatrixOperations::ReduceToMinTerms(tmp);
+    mergeMinTerms(current, tmp, s.front, c1);
+
+    // the verification below can only drop terms if there are at least three with negative alpha
+    if (std::ranges::count_if(c1, [](scout::term t) { return t.first < 0; }) < 3)
+    {
+        tmp2.assign(c1.begin(), c1.end());
+        return true;
+    }
+
+    // verification if every term is minimal for some n: the terms with negative alpha have to form the lower hull. The
+    // chain runs over their positions sorted by (alpha, beta); a term is dropped if the one before dominates it or once the
+    // term after it comes in at a slope that is not steeper. The rest keep their order in c1.
+    auto& hull = s.hull;
+    hull.clear();
+    for (std::size_t l = 0; l < c1.size(); ++l)
+    {
+        if (c1[l].first < 0)
+        {
+            hull.emplace_back(l);
+        }
+    }
+    std::ranges::sort(hull, [&c1](std::size_t l, std::size_t n) { return c1[l] < c1[n]; });
+    std::size_t kept = 0;
+    for (auto o : hull)
+    {
+        auto maxAlpha = c1[o];
+        if (kept > 0 && c1[hull[kept - 1]].second <= maxAlpha.second)
+        {
+            continue;
+        }
+        while (kept >= 2)
+        {
+            auto minAlpha = c1[hull[kept - 2]];
+            auto midAlpha = c1[hull[kept - 1]];
+            auto s1 = scout::TermDifference(maxAlpha.second, minAlpha.second) / scout::TermDifference(minAlpha.first, maxAlpha.first);
+            auto s2 = scout::TermDifference(maxAlpha.second, midAlpha.second) / scout::TermDifference(midAlpha.first, maxAlpha.first);
+            if (s1 > s2)
             {
-                if (i == k || j == k)
-                    continue;
-                auto& c1 = m[i][j];
-                auto const& c2 = m[i][k];
-                auto const& c3 = m[k][j];
+                break;
+            }
+            --kept;
+        }
+        hull[kept++] = o;
+    }
+    hull.resize(kept);
+    std::ranges::sort(hull);
 
-                tmp.clear();
-                for (auto [a2, b2] : c2)
-                {
-                    for (auto [a3, b3] : c3)
-                    {
-                        tmp.emplace_back(a2 + a3, b2 + b3);
-                    }
-                }
-                if (tmp.empty())
-                {
-                    continue;
-                }
+    tmp2.clear();
+    auto next = hull.begin();
+    for (std::size_t l = 0; l < c1.size(); ++l)
+    {
+        if (c1[l].first >= 0)
+        {
+            tmp2.emplace_back(c1[l]);
+        }
+        else if (next != hull.end() && *next == l)
+        {
+            tmp2.emplace_back(c1[l]);
+            ++next;
+        }
+    }
+    return true;
+}
 
-                std::sort(tmp.begin(), tmp.end());
+// one Floyd-Warshall step through k for the rows [begin, end). Within one step row k and column k stay fixed and every
+// other cell is only read by its own update, so row blocks are independent. With deferGrowth cells that outgrow their
+// slot are parked in s instead of growing the arena, which keeps concurrent sweeps over distinct rows safe.
+static void relaxRows(scout::matrix& m, int k, int begin, int end, scout::closure_scratch& s, bool deferGrowth)
+{
+    auto size = m.Size();
+    for (int i = begin; i < end; ++i)
+    {
+        if (i == k)
+            continue;
+        auto ik = m(i, k);
+        if (ik.empty())
+            continue;
+        // copied since updating row i may move the terms of m(i, k) within the arena
+        s.c2.assign(ik.begin(), ik.end());
 
-                auto prev_a = tmp[0].first - 1;
-                for (auto [a, b] : tmp)
-                {
-                    if (a != prev_a)
-                    {
-                        prev_a = a;
+        for (int j = 0; j < size; ++j)
+        {
+            if (j == k)
+                continue;
+            if constexpr (scout::COLLECT_STATS)
+            {
+                ++s.relaxations;
+            }
+            if (!relaxCell(s, m(k, j), m(i, j)))
+                continue;
 
-                        updateCellWithTerm(c1, a, b);
-                    }
-                }
+            if (!deferGrowth)
+            {
+                m.Assign(i, j, s.tmp2);
+            }
+            else if (!m.TryAssign(i, j, s.tmp2))
+            {
+                s.deferredTerms.insert(s.deferredTerms.end(), s.tmp2.begin(), s.tmp2.end());
+                s.deferredCells.emplace_back(i, j, s.deferredTerms.size());
+            }
+        }
+    }
+}
+
+static std::int64_t maxAbsConstant(scout::matrix const& m)
+{
+    std::int64_t maxAbs = 0;
+    for (int i = 0; i < m.Size(); ++i)
+    {
+        for (int j = 0; j < m.Size(); ++j)
+        {
+            auto c = m(i, j);
+            if (!c.empty())
+            {
+                maxAbs = std::max<std::int64_t>(maxAbs, std::abs(std::int64_t(c[0].second)));
+            }
+        }
+    }
+    return maxAbs;
+}
+
+// no path has more than pathLength edges, so int32 suffices unless pathLength * max|c| leaves its finite range
+static bool fitsInt32(std::int64_t maxAbs, int pathLength) { return maxAbs * (pathLength + 1) < scout::dense_matrix<std::int32_t>::MAX_FINITE; }
+
+// The half matrix kernels find the same shortest paths as the full ones, but once there is a negative cycle both only
+// produce some lower bounds, and these differ. Such results still end up in closures (as the powers before the first
+// inconsistent one that is checked), so they are computed again on the full matrix to stay as they were.
+template <typename DenseOrHalf>
+static bool hasNegativeCycle(DenseOrHalf const& m)
+{
+    for (int i = 0; i < m.Size(); ++i)
+    {
+        if (m(i, i) < 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T>
+static void closeNonParametric(scout::matrix& m, bool tighten, scout::Workspace& workspace)
+{
+    if (scout::MatrixOperations::IsCoherent(m))
+    {
+        auto& half = workspace.Half<T>();
+        half.res.Load(m);
+        scout::MatrixOperations::OctagonalFloydWarshallAlgorithm(half.res, half.scratch);
+        if (tighten)
+        {
+            scout::MatrixOperations::CalculateOctagonalTightClosure(half.res, half.scratch);
+        }
+        if (!hasNegativeCycle(half.res))
+        {
+            half.res.Store(m);
+            return;
+        }
+    }
+    auto& dense = workspace.Dense<T>();
+    dense.res.Load(m);
+    scout::MatrixOperations::IntegerFloydWarshallAlgorithm(dense.res);
+    if (tighten)
+    {
+        scout::MatrixOperations::CalculateIntegerTightClosure(dense.res, dense.scratch);
+    }
+    dense.res.Store(m);
+}
+
+static void closeNonParametric(scout::matrix& m, bool tighten, scout::Workspace& workspace)
+{
+    if (fitsInt32(maxAbsConstant(m), m.Size()))
+    {
+        if (scout::MatrixOperations::CloseFixedSize(m, tighten))
+        {
+            return;
+        }
+        closeNonParametric<std::int32_t>(m, tighten, workspace);
+        return;
+    }
+    closeNonParametric<std::int64_t>(m, tighten, workspace);
+}
 
-                // verification if every term is minimal for some n
-                cell tmp2;
-                auto numberOfLoops = c1.size();
-                for (int l = 0; l < numberOfLoops; ++l)
+// below this size a step through k is too short to be worth handing to other threads
+static constexpr int PARALLEL_MIN_SIZE = 32;
+
+scout::matrix scout::MatrixOperations::ParametricFloydWarshallAlgorithm(matrix m, bool tighten)
+{
+    CloseInPlace(m, tighten);
+    return m;
+}
+
+void scout::MatrixOperations::CloseInPlace(matrix& m, bool tighten, Workspace& workspace)
+{
+    if (IsNonParametric(m))
+    {
+        closeNonParametric(m, tighten, workspace);
+        return;
+    }
+
+    auto size = m.Size();
+    auto& pool = GetThreadPool();
+    auto& scratch = workspace.threads;
+    if (scratch.size() < std::size_t(pool.Size()))
+    {
+        scratch.resize(pool.Size());
+    }
+
+    if (pool.Size() == 1 || size < PARALLEL_MIN_SIZE)
+    {
+        for (int k = 0; k < size; ++k)
+        {
+            relaxRows(m, k, 0, size, scratch[0], false);
+        }
+    }
+    else
+    {
+        auto blocks = std::min(size, 4 * pool.Size());
+        for (int k = 0; k < size; ++k)
+        {
+            pool.ParallelFor(blocks, [&](int block, int thread) { relaxRows(m, k, block * size / blocks, (block + 1) * size / blocks, scratch[thread], true); });
+
+            // the parked cells are distinct and nobody read them during the sweep, so the write back order is irrelevant
+            for (auto& s : scratch)
+            {
+                std::size_t begin = 0;
+                for (auto [i, j, end] : s.deferredCells)
                 {
-                    auto term1 = c1[l];
-                    bool minTerm = true;
-
-                    for (int n = l + 1; n < numberOfLoops; ++n)
-                    {
-                        if (term1.first >= 0)
-                            break;
-                        auto term2 = c1[n];
-                        if (term1.first == term2.first || term2.first >= 0)
-                            continue;
-
-                        auto minAlpha = term1.first < term2.first ? term1 : term2;
-                        auto midAlpha = term1;
-                        auto maxAlpha = term1.first > term2.first ? term1 : term2;
-
-                        for (int o = n + 1; o < numberOfLoops; ++o)
-                        {
-                            auto term3 = c1[o];
-                            if (term1.first == term3.first || term2.first == term3.first || term3.first >= 0)
-                            {
-                                continue;
-                            }
-                            if (term3.first < minAlpha.first)
-                            {
-                                midAlpha = minAlpha;
-                                minAlpha = term3;
-                            }
-                            else if (term3.first > maxAlpha.first)
-                            {
-                                midAlpha = maxAlpha;
-                                maxAlpha = term3;
-                            }
-                            else
-                            {
-                                midAlpha = term3;
-                            }
-
-                            auto s1 = (maxAlpha.second - minAlpha.second) / (minAlpha.first - maxAlpha.first);
-                            auto s2 = (maxAlpha.second - midAlpha.second) / (midAlpha.first - maxAlpha.first);
-
-                            if (s1 <= s2)
-                            {
-                                if (term1 == midAlpha)
-                                {
-                                    minTerm = false;
-                                    break;
-                                }
-                                else if (term2 == midAlpha)
-                                {
-                                    c1[n] = term1;
-                                    c1[l] = term2;
-                                    minTerm = false;
-                                    break;
-                                }
-                                else
-                                {
-                                    c1[o] = term1;
-                                    c1[l] = term3;
-                                    minTerm = false;
-                                    break;
-                                }
-                            }
-                        }
-                        if (!minTerm)
-                        {
-                            break;
-                        }
-                    }
-                    if (minTerm)
-                    {
-                        tmp2.emplace_back(term1);
-                    }
+                    m.Assign(i, j, cell_view(s.deferredTerms.data() + begin, end - begin));
+                    begin = end;
                 }
-                m[i][j] = tmp2;
+                s.deferredCells.clear();
+                s.deferredTerms.clear();
             }
         }
     }
-    auto t1 = std::chrono::high_resolution_clock::now();
+    for (auto& s : scratch)
+    {
+        RecordStats([&](ClosureStats& stats) { stats.relaxations += s.relaxations; });
+        s.relaxations = 0;
+    }
 
     // tighten
     if (tighten)
     {
-        m = MatrixOperations::CalculateTightClosure(m);
+        TightenInPlace(m, workspace);
     }
+}
 
+scout::matrix scout::MatrixOperations::CalculateTightClosure(matrix m)
+{
+    TightenInPlace(m);
     return m;
 }
 
-scout::matrix scout::MatrixOperations::CalculateTightClosure(matrix m)
+void scout::MatrixOperations::TightenInPlace(matrix& m, Workspace& workspace)
 {
-    auto size = m.size();
-    matrix tightClosure = m;
+    auto size = m.Size();
 
+    // every cell only depends on itself and the halves, which are taken before any cell changes
+    auto& rowHalves = workspace.rowHalves;
+    auto& columnHalves = workspace.columnHalves;
+    if (rowHalves.size() < std::size_t(size))
+    {
+        rowHalves.resize(size);
+        columnHalves.resize(size);
+    }
+    for (int i = 0; i < size; ++i)
+    {
+        halfTermsInto(rowHalves[i], m(i, MatrixOperations::IDash(i)));
+        halfTermsInto(columnHalves[i], m(MatrixOperations::IDash(i), i));
+    }
     for (int i = 0; i < size; ++i)
     {
         for (int j = 0; j < size; ++j)
         {
-            auto cell1 = m[i][j];
-            auto cell2 = MatrixOperations::HalfTerms(m[i][MatrixOperations::IDash(i)]);
-            auto cell3 = MatrixOperations::HalfTerms(m[MatrixOperations::IDash(j)][j]);
-
-            tightClosure[i][j] = MatrixOperations::MinTerms(cell1, cell2, cell3);
+            minTermsInto(workspace.minTerms, m(i, j), rowHalves[i], columnHalves[j]);
+            m.Assign(i, j, workspace.minTerms);
         }
     }
-
-    return tightClosure;
 }
 
-scout::cell scout::MatrixOperations::MinTerms(cell const& c1, cell const& c2, cell const& c3)
+bool scout::MatrixOperations::IsCoherent(matrix const& m)
 {
-    std::set<std::pair<int, int>> omniSet(c1.begin(), c1.end());
-    std::set<std::pair<int, int>> minTerms;
-    for (auto termInCell2 : c2)
+    if (m.Size() % 2 != 0)
     {
-        for (auto termInCell3 : c3)
+        return false;
+    }
+    for (int i = 0; i < m.Size(); ++i)
+    {
+        for (int j = 0; j <= (i | 1); ++j)
         {
-            omniSet.emplace(termInCell2.first + termInCell3.first, termInCell2.second + termInCell3.second);
+            if (!std::ranges::equal(m(i, j), m(IDash(j), IDash(i))))
+            {
+                return false;
+            }
         }
     }
-
-    return MinCell(omniSet);
+    return true;
 }
 
-scout::cell scout::MatrixOperations::MinCell(std::set<std::pair<int, int>> const& omniSet)
+bool scout::MatrixOperations::IsNonParametric(matrix const& m)
 {
-    cell minTerms;
-    for (auto it1 = omniSet.begin(); it1 != omniSet.end(); ++it1)
+    for (int i = 0; i < m.Size(); ++i)
     {
-        bool isMinTerm = true;
-        for (auto it2 = omniSet.begin(); it2 != omniSet.end(); ++it2)
+        for (int j = 0; j < m.Size(); ++j)
         {
-            if (it1 == it2)
+            auto c = m(i, j);
+            if (c.size() > 1 || (c.size() == 1 && c[0].first != 0))
             {
-                continue;
+                return false;
             }
-            if ((it2->first < it1->first || it2->second < it1->second) && (it2->first <= it1->first && it2->second <= it1->second))
-            {
-                isMinTerm = false;
-                break;
-            }
-        }
-        if (isMinTerm)
-        {
-            minTerms.emplace_back(*it1);
         }
     }
+    return true;
+}
+
+scout::matrix scout::MatrixOperations::NonParametricClosure(matrix const& m, bool tighten)
+{
+    matrix closed = m;
+    closeNonParametric(closed, tighten, Workspace::Local());
+    return closed;
+}
+
+scout::cell scout::MatrixOperations::MinTerms(cell_view c1, cell_view c2, cell_view c3)
+{
+    cell minTerms;
+    minTermsInto(minTerms, c1, c2, c3);
     return minTerms;
 }
 
-scout::cell scout::MatrixOperations::HalfTerms(cell const& c)
+scout::cell scout::MatrixOperations::MinCell(std::set<term> const& omniSet)
 {
-    cell halfTerms;
+    cell minTerms(omniSet.begin(), omniSet.end());
+    ReduceToMinTerms(minTerms);
+    return minTerms;
+}
 
-    for (auto term : c)
+void scout::MatrixOperations::ReduceToMinTerms(cell& terms)
+{
+    std::sort(terms.begin(), terms.end());
+    // in (alpha, beta) order a term is a minterm iff its beta is below the beta of every term before it
+    auto kept = terms.begin();
+    for (auto it = terms.begin(); it != terms.end(); ++it)
     {
-        halfTerms.emplace_back(MatrixOperations::HalfInt(term.first), MatrixOperations::HalfInt(term.second));
+        if (kept == terms.begin() || it->second < std::prev(kept)->second)
+        {
+            *kept++ = *it;
+        }
     }
+    terms.erase(kept, terms.end());
+}
 
+scout::cell scout::MatrixOperations::HalfTerms(cell_view c)
+{
+    cell halfTerms;
+    halfTermsInto(halfTerms, c);
     return halfTerms;
 }
 
-int scout::MatrixOperations::HalfInt(int val)
+scout::term_value scout::MatrixOperations::HalfInt(term_value val)
 {
     auto value = ((val < 0) && (val % 2 != 0)) ? (val / 2) - 1 : val / 2;
     return value;
@@ -260,10 +529,11 @@ int scout::MatrixOperations::IDash(int val)
 
 [[maybe_unused]] void scout::MatrixOperations::PrintMatrix(matrix const& m)
 {
-    for (auto const& row : m)
+    for (int i = 0; i < m.Size(); ++i)
     {
-        for (auto const& column : row)
+        for (int j = 0; j < m.Size(); ++j)
         {
+            auto column = m(i, j);
             if (column.empty())
             {
                 std::cout << "INFTY\t";
@@ -278,30 +548,32 @@ int scout::MatrixOperations::IDash(int val)
 
 scout::matrix scout::MatrixOperations::IntegerMatrixSubtraction(matrix m1, matrix const& m2)
 {
-    auto size = m1.size();
-    if (size != m2.size())
+    auto size = m1.Size();
+    if (size != m2.Size())
     {
         throw std::invalid_argument("Illegal Matrix Subtraction");
     }
     for (int i = 0; i < size; ++i)
     {
-        for (int j = 0; j < m1[i].size(); ++j)
+        for (int j = 0; j < size; ++j)
         {
-            if ((m1[i][j].empty() && !m2[i][j].empty()))
+            auto c1 = m1(i, j);
+            auto c2 = m2(i, j);
+            if ((c1.empty() && !c2.empty()))
             {
-                m1[i][j].emplace_back(1, 0);
+                m1.Append(i, j, {1, 0});
                 return m1;
             }
-            if ((!m1[i][j].empty() && m2[i][j].empty()))
+            if ((!c1.empty() && c2.empty()))
             {
-                m1[i][j][0].first = -1;
+                c1[0].first = -1;
                 return m1;
             }
-            if (m1[i][j].empty() || m2[i][j].empty())
+            if (c1.empty() || c2.empty())
             {
                 continue;
             }
-            m1[i][j][0].second -= m2[i][j][0].second;
+            c1[0].second = TermDifference(c1[0].second, c2[0].second);
         }
     }
 
@@ -310,8 +582,8 @@ scout::matrix scout::MatrixOperations::IntegerMatrixSubtraction(matrix m1, matri
 
 scout::matrix scout::MatrixOperations::MatrixAddition(matrix m1, matrix const& m2)
 {
-    auto size = m1.size();
-    if (size != m2.size())
+    auto size = m1.Size();
+    if (size != m2.Size())
     {
         throw std::invalid_argument("Illegal Matrix Addition");
     }
@@ -319,66 +591,227 @@ scout::matrix scout::MatrixOperations::MatrixAddition(matrix m1, matrix const& m
     {
         for (int j = 0; j < size; ++j)
         {
-            if (m1[i][j].empty() || m2[i][j].empty())
+            auto c1 = m1(i, j);
+            auto c2 = m2(i, j);
+            if (c1.empty() || c2.empty())
             {
                 continue;
             }
-            m1[i][j][0].first = m2[i][j][0].second;
+            c1[0].first = c2[0].second;
         }
     }
     return m1;
 }
 
-scout::matrix scout::MatrixOperations::MatrixComposition(matrix const& m1, matrix const& m2, bool tighten)
+// the block matrix over x, x' and x'' with m1 on (x, x') and m2 on (x', x'')
+static void compositionBlockInto(scout::matrix& res, scout::matrix const& m1, scout::matrix const& m2)
 {
-    auto baseSize = m1.size();
+    auto baseSize = m1.Size();
     auto halfSize = baseSize / 2;
     auto size = baseSize + halfSize;
-    matrix res(size);
+    res.Reset(size);
+
+    // the shared block only keeps the smaller constant, so the block matrix stays non-parametric
+    auto nonParametric = scout::MatrixOperations::IsNonParametric(m1) && scout::MatrixOperations::IsNonParametric(m2);
 
     for (int i = 0; i < size; ++i)
     {
-        std::vector<cell> row(size);
         for (int j = 0; j < size; ++j)
         {
-            int i2 = i - (int)halfSize;
-            int j2 = j - (int)halfSize;
+            int i2 = i - halfSize;
+            int j2 = j - halfSize;
 
             if (i < baseSize && j < baseSize)
             {
-                for (auto const& term : m1[i][j])
+                for (auto const& term : m1(i, j))
                 {
-                    row[j].emplace_back(term);
+                    res.Append(i, j, term);
                 }
             }
             if (i2 >= 0 && j2 >= 0)
             {
-                for (auto const& term : m2[i2][j2])
+                auto current = res(i, j);
+                if (nonParametric && !current.empty() && !m2(i2, j2).empty())
                 {
-                    row[j].emplace_back(term);
+                    current[0].second = std::min(current[0].second, m2(i2, j2)[0].second);
+                    continue;
+                }
+                for (auto const& term : m2(i2, j2))
+                {
+                    res.Append(i, j, term);
                 }
             }
         }
-        res[i] = row;
     }
-    res = ParametricFloydWarshallAlgorithm(res, tighten);
-    return res;
 }
 
-scout::matrix scout::MatrixOperations::CalcExtremalPaths(matrix m)
+// drops the x' rows and columns of a closed block matrix
+static void extremalPathsInto(scout::matrix& reduced, scout::matrix const& m)
 {
-    auto baseSize = m.size() / 3 * 2;
+    auto baseSize = m.Size() / 3 * 2;
     auto halfSize = baseSize / 2;
-    matrix reduced(baseSize);
+    reduced.Reset(baseSize);
 
     for (int i = 0; i < baseSize; ++i)
     {
         for (int j = 0; j < baseSize; ++j)
         {
-            int posI = i >= halfSize ? i + (int)halfSize : i;
-            int posJ = j >= halfSize ? j + (int)halfSize : j;
-            reduced[i].emplace_back(m[posI][posJ]);
+            int posI = i >= halfSize ? i + halfSize : i;
+            int posJ = j >= halfSize ? j + halfSize : j;
+            reduced.Assign(i, j, m(posI, posJ));
         }
     }
+}
+
+scout::matrix scout::MatrixOperations::MatrixComposition(matrix const& m1, matrix const& m2, bool tighten)
+{
+    matrix res;
+    compositionBlockInto(res, m1, m2);
+    CloseInPlace(res, tighten);
+    return res;
+}
+
+scout::matrix scout::MatrixOperations::CalcExtremalPaths(matrix m)
+{
+    matrix reduced;
+    extremalPathsInto(reduced, m);
     return reduced;
 }
+
+// a diagonal cell below zero, see Relation::ConsistencyCheck
+static bool hasNegativeCycle(scout::matrix const& m)
+{
+    for (int i = 0; i < m.Size(); ++i)
+    {
+        auto c = m(i, i);
+        if (!c.empty() && c[0].second < 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// CalcExtremalPaths(MatrixComposition(m1, m2, tighten)) on the buffers of workspace
+static void composeBlock(scout::matrix& result, scout::matrix const& m1, scout::matrix const& m2, bool tighten, scout::Workspace& workspace)
+{
+    compositionBlockInto(workspace.block, m1, m2);
+    scout::MatrixOperations::CloseInPlace(workspace.block, tighten, workspace);
+    extremalPathsInto(result, workspace.block);
+}
+
+// how a composition on the integer kernels ended
+enum compositionResult
+{
+    STORED,
+    EMPTY,
+    // a negative cycle that the kernels do not resolve like the block matrix does, result is unchanged
+    UNDECIDED
+};
+
+// The kernels only relax paths through the shared variables, which gives the block matrix closure as long as there is no
+// negative cycle. Once there is one, both only produce some lower bounds, and these differ. Such results still end up in
+// closures (as the powers before the first inconsistent one that is checked), so they are left to the block matrix. With
+// closed operands and a closed shared block without negative cycles, a negative diagonal cell of the result is a negative
+// cycle through an outer variable, which the block matrix finds as well; stopIfEmpty stops the kernels there.
+template <typename T>
+static compositionResult composeClosed(scout::matrix& result, scout::matrix const& m1, scout::matrix const& m2, bool tighten, scout::Workspace& workspace,
+                                       bool stopIfEmpty)
+{
+    // the blocks of x, x' and x'' have to keep the pairs (i, i') together, which holds for every octagon
+    if (m1.Size() % 4 == 0 && scout::MatrixOperations::IsCoherent(m1) && scout::MatrixOperations::IsCoherent(m2))
+    {
+        auto& half = workspace.Half<T>();
+        half.m1.Load(m1);
+        half.m2.Load(m2);
+        scout::MatrixOperations::OctagonalMatrixComposition(half.m1, half.m2, tighten, half.res, half.scratch);
+        // a negative cycle among the shared variables does not have to reach the diagonal of the result
+        if (!hasNegativeCycle(half.scratch.shared) && !hasNegativeCycle(half.res))
+        {
+            half.res.Store(result);
+            return STORED;
+        }
+        if (!stopIfEmpty)
+        {
+            return UNDECIDED;
+        }
+    }
+    auto& dense = workspace.Dense<T>();
+    dense.m1.Load(m1);
+    dense.m2.Load(m2);
+    bool consistent = true;
+    if (stopIfEmpty)
+    {
+        consistent = scout::MatrixOperations::ConsistentIntegerMatrixComposition(dense.m1, dense.m2, tighten, dense.res, dense.scratch);
+    }
+    else
+    {
+        scout::MatrixOperations::IntegerMatrixComposition(dense.m1, dense.m2, tighten, dense.res, dense.scratch);
+    }
+    // the shared block is closed before the kernels relax the first row, so it is complete even if they stopped
+    if (hasNegativeCycle(dense.scratch.shared))
+    {
+        return UNDECIDED;
+    }
+    if (!consistent)
+    {
+        return EMPTY;
+    }
+    if (hasNegativeCycle(dense.res))
+    {
+        return UNDECIDED;
+    }
+    dense.res.Store(result);
+    return STORED;
+}
+
+// composeClosed on the int32 or int64 kernels, fixed size ones if there are any; UNDECIDED for parametric operands
+static compositionResult composeNonParametric(scout::matrix& result, scout::matrix const& m1, scout::matrix const& m2, bool tighten,
+                                              scout::Workspace& workspace, bool stopIfEmpty)
+{
+    using namespace scout::MatrixOperations;
+    if (!IsNonParametric(m1) || !IsNonParametric(m2) || hasNegativeCycle(m1) || hasNegativeCycle(m2))
+    {
+        return UNDECIDED;
+    }
+    if (fitsInt32(std::max(maxAbsConstant(m1), maxAbsConstant(m2)), m1.Size() + m1.Size() / 2))
+    {
+        // the fixed size kernels are too short to be worth stopping
+        if (ComposeFixedSize(result, m1, m2, tighten))
+        {
+            return STORED;
+        }
+        return composeClosed<std::int32_t>(result, m1, m2, tighten, workspace, stopIfEmpty);
+    }
+    return composeClosed<std::int64_t>(result, m1, m2, tighten, workspace, stopIfEmpty);
+}
+
+scout::matrix scout::MatrixOperations::ComposeClosed(matrix const& m1, matrix const& m2, bool tighten)
+{
+    matrix res;
+    ComposeClosedInto(res, m1, m2, tighten);
+    return res;
+}
+
+void scout::MatrixOperations::ComposeClosedInto(matrix& result, matrix const& m1, matrix const& m2, bool tighten, Workspace& workspace)
+{
+    if (composeNonParametric(result, m1, m2, tighten, workspace, false) != STORED)
+    {
+        composeBlock(result, m1, m2, tighten, workspace);
+    }
+}
+
+bool scout::MatrixOperations::ComposeClosedIfConsistent(matrix& result, matrix const& m1, matrix const& m2, bool tighten, Workspace& workspace)
+{
+    switch (composeNonParametric(result, m1, m2, tighten, workspace, true))
+    {
+    case STORED:
+        return true;
+    case EMPTY:
+        return false;
+    case UNDECIDED:
+        break;
+    }
+    composeBlock(result, m1, m2, tighten, workspace);
+    return !hasNegativeCycle(result);
+}
@@ -1,28 +1,92 @@
 #pragma once
 
+#include <cstdint>
 #include <set>
 #include <vector>
 
 #include "Common.hpp"
+#include "DenseMatrix.hpp"
+#include "HalfMatrix.hpp"
+#include "Matrix.hpp"
 #include "Relation.hpp"
+#include "ThreadPool.hpp"
+#include "Workspace.hpp"
 
 namespace scout
 {
 namespace MatrixOperations
 {
 
+// Threads used by the closure kernels, including the calling one. The default of 1 runs everything on the calling thread.
+// Must not be changed while a closure is being computed.
+void SetThreadCount(int threads);
+int GetThreadCount();
+ThreadPool& GetThreadPool();
+
 // these functions refer to the algorithms shown in the thesis
 matrix ParametricFloydWarshallAlgorithm(matrix m, bool tighten);
 
-cell MinTerms(cell const& c1, cell const& c2, cell const& c3);
+// In-place versions of ParametricFloydWarshallAlgorithm, CalculateTightClosure and ComposeClosed. They reuse the storage
+// of the matrix they write and take all scratch buffers from workspace, so with a warmed up workspace they run without
+// heap allocations (see AllocationCount). result may be one of the operands.
+void CloseInPlace(matrix& m, bool tighten, Workspace& workspace = Workspace::Local());
+void TightenInPlace(matrix& m, Workspace& workspace = Workspace::Local());
+void ComposeClosedInto(matrix& result, matrix const& m1, matrix const& m2, bool tighten, Workspace& workspace = Workspace::Local());
+
+// ComposeClosedInto for callers that only need the result if it is consistent. Returns false if a diagonal cell of the
+// result is negative, i.e. the composition is an empty relation, and stops the kernels as soon as they find one; result
+// is unspecified then. Otherwise result is the same as ComposeClosedInto gives.
+bool ComposeClosedIfConsistent(matrix& result, matrix const& m1, matrix const& m2, bool tighten, Workspace& workspace = Workspace::Local());
+
+cell MinTerms(cell_view c1, cell_view c2, cell_view c3);
+
+cell MinCell(std::set<term> const& omniSet);
 
-cell MinCell(std::set<std::pair<int, int>> const& omniSet);
+// Sorts terms by (alpha, beta) and keeps the minterms, i.e. the terms no other term undercuts in alpha and beta at once.
+// Afterwards alpha rises and beta falls strictly along the cell. O(t log t)
+void ReduceToMinTerms(cell& terms);
 
 matrix CalculateTightClosure(matrix m);
 
-cell HalfTerms(cell const& c);
+// true if every cell holds at most one term and that term is constant (alpha == 0)
+bool IsNonParametric(matrix const& m);
+
+// ParametricFloydWarshallAlgorithm for non-parametric matrices, runs on the dense integer kernels
+matrix NonParametricClosure(matrix const& m, bool tighten);
+
+// Relations of up to FIXED_MAX_SIZE / 4 octagonal or FIXED_MAX_SIZE / 2 DBM variables are closed and composed on
+// kernels compiled for their size (see FixedMatrix.hpp). CloseFixedSize and ComposeFixedSize take non-parametric
+// matrices whose paths fit int32 and return false if there is no kernel for the size. ComposeFixedSize also returns false,
+// leaving result as it is, if the shared block or the result has a negative cycle. result may be one of the operands.
+constexpr int FIXED_MAX_SIZE = 32;
+bool CloseFixedSize(matrix& m, bool tighten);
+bool ComposeFixedSize(matrix& result, matrix const& m1, matrix const& m2, bool tighten);
+
+void IntegerFloydWarshallAlgorithm(dense_matrix<std::int32_t>& m);
+void IntegerFloydWarshallAlgorithm(dense_matrix<std::int64_t>& m);
+
+void CalculateIntegerTightClosure(dense_matrix<std::int32_t>& m, dense_scratch<std::int32_t>& scratch);
+void CalculateIntegerTightClosure(dense_matrix<std::int64_t>& m, dense_scratch<std::int64_t>& scratch);
 
-int HalfInt(int val);
+// true if m(i, j) == m(j', i') for all cells, which holds for every octagon. Coherent non-parametric matrices that are too
+// large for the fixed size kernels are closed and composed as half_matrix.
+bool IsCoherent(matrix const& m);
+
+void OctagonalFloydWarshallAlgorithm(half_matrix<std::int32_t>& m, half_scratch<std::int32_t>& scratch);
+void OctagonalFloydWarshallAlgorithm(half_matrix<std::int64_t>& m, half_scratch<std::int64_t>& scratch);
+
+void CalculateOctagonalTightClosure(half_matrix<std::int32_t>& m, half_scratch<std::int32_t>& scratch);
+void CalculateOctagonalTightClosure(half_matrix<std::int64_t>& m, half_scratch<std::int64_t>& scratch);
+
+// res must not be one of the operands
+void OctagonalMatrixComposition(half_matrix<std::int32_t> const& m1, half_matrix<std::int32_t> const& m2, bool tighten, half_matrix<std::int32_t>& res,
+                                half_scratch<std::int32_t>& scratch);
+void OctagonalMatrixComposition(half_matrix<std::int64_t> const& m1, half_matrix<std::int64_t> const& m2, bool tighten, half_matrix<std::int64_t>& res,
+                                half_scratch<std::int64_t>& scratch);
+
+cell HalfTerms(cell_view c);
+
+term_value HalfInt(term_value val);
 
 int IDash(int val);
 
@@ -35,5 +99,22 @@ matrix MatrixAddition(matrix m1, matrix const& m2);
 matrix MatrixComposition(matrix const& m1, matrix const& m2, bool tighten);
 matrix CalcExtremalPaths(matrix m);
 
+// CalcExtremalPaths(MatrixComposition(m1, m2, tighten)) for closed operands. Non-parametric operands only relax paths
+// through the shared variables instead of closing the whole block matrix, unless that runs into a negative cycle; then
+// the block matrix is closed after all, so an inconsistent result has the same constants as well.
+matrix ComposeClosed(matrix const& m1, matrix const& m2, bool tighten);
+
+// res must not be one of the operands
+void IntegerMatrixComposition(dense_matrix<std::int32_t> const& m1, dense_matrix<std::int32_t> const& m2, bool tighten, dense_matrix<std::int32_t>& res,
+                              dense_scratch<std::int32_t>& scratch);
+void IntegerMatrixComposition(dense_matrix<std::int64_t> const& m1, dense_matrix<std::int64_t> const& m2, bool tighten, dense_matrix<std::int64_t>& res,
+                              dense_scratch<std::int64_t>& scratch);
+
+// IntegerMatrixComposition that returns false as soon as a diagonal cell of res becomes negative, res is unfinished then
+bool ConsistentIntegerMatrixComposition(dense_matrix<std::int32_t> const& m1, dense_matrix<std::int32_t> const& m2, bool tighten,
+                                        dense_matrix<std::int32_t>& res, dense_scratch<std::int32_t>& scratch);
+bool ConsistentIntegerMatrixComposition(dense_matrix<std::int64_t> const& m1, dense_matrix<std::int64_t> const& m2, bool tighten,
+                                        dense_matrix<std::int64_t>& res, dense_scratch<std::int64_t>& scratch);
+
 } // namespace MatrixOperations
 } // namespace scout
@@ -1,6 +1,9 @@
 #include "Parser.hpp"
+#include "MappedFile.hpp"
 #include "MatrixOperations.hpp"
 
+#include <limits>
+#include <stdexcept>
 #include <string_view>
 
 // Allowed Symbols
@@ -8,90 +11,55 @@ static constexpr std::string_view VARIABLE_NAME_SYMBOLS = "abcdefghijklmnopqrstu
 static constexpr std::string_view DIGITS = "1234567890";
 static constexpr std::string_view LOGIC_SYMBOLS = "+-*/<>=&";
 
-scout::Relation scout::Parser::RetrieveRelation(std::string const& filePath)
-{
-    Relation r;
-    auto relationAsString = Parser::ReadRelation(filePath);
-    auto tokens = Parser::TokenizeRelation(relationAsString, r);
-    auto tokenizedFormula = Parser::MakeFormula(tokens);
-    tokenizedFormula = Parser::AddTokens(tokenizedFormula);
-    tokenizedFormula = Parser::NormalizeTokens(tokenizedFormula);
-    r.SetIsOctagonal(Parser::VerifyValidity(tokenizedFormula));
-    Parser::MakeRelation(tokenizedFormula, r);
-    return r;
-}
+// ReadRelation drops these, so tokens may span them
+static bool isIgnored(char character) { return character == ' ' || character == '\n'; }
 
-std::string scout::Parser::ReadRelation(std::string const& filePath)
+// position in the relation text; every read skips the ignored characters first
+struct relation_cursor
 {
-    std::ifstream file;
-    file.open(filePath);
-    if (!file)
-    {
-        throw std::invalid_argument("No such File exists");
-    }
-    std::string line, input, relation;
-    while (getline(file, line))
-    {
-        input.append(line);
-    }
-    auto pos1 = input.find(':');
-    if (pos1 != std::string::npos)
+    std::string_view text;
+    std::size_t position = 0;
+
+    bool AtEnd()
     {
-        for (auto pos2 = pos1 + 1; pos2 + 1 != std::string::npos; ++pos2)
+        while (position < text.size() && isIgnored(text[position]))
         {
-            if (input[pos2] == ';')
-            {
-                break;
-            }
-            if (input[pos2] != ' ')
-            {
-                relation += input[pos2];
-            }
+            ++position;
         }
+        return position == text.size();
     }
-    return relation;
-}
 
-std::vector<scout::token> scout::Parser::TokenizeRelation(std::string const& relation, Relation& r)
-{
-    std::pair<std::vector<token>, std::string> tokenStream = std::make_pair(std::vector<token>{}, relation);
-    return Parser::ConsumeToken(tokenStream, r).first;
-}
+    // the next character, '\0' at the end
+    char Peek() { return AtEnd() ? '\0' : text[position]; }
 
-std::pair<std::vector<scout::token>, std::string> scout::Parser::ConsumeToken(std::pair<std::vector<token>, std::string> tokenStream, Relation& r)
-{
-    if (tokenStream.second.length() == 0)
-    {
-        return tokenStream;
-    }
+    void Advance() { ++position; }
+};
 
-    if (LOGIC_SYMBOLS.find(tokenStream.second[0]) != std::string::npos)
-    {
-        tokenStream = Parser::ConsumeSymbol(tokenStream);
-    }
-    else
+// a constant of the relation; like std::stoi it throws std::out_of_range if the value does not fit a term
+static scout::term_value parseConstant(std::string const& digits)
+{
+    auto value = std::stoll(digits);
+    if (value < std::numeric_limits<scout::term_value>::min() || value > std::numeric_limits<scout::term_value>::max())
     {
-        tokenStream = Parser::ConsumeVarOrConst(tokenStream, r);
+        throw std::out_of_range("Constant " + digits + " does not fit a term");
     }
-
-    return Parser::ConsumeToken(tokenStream, r);
+    return scout::term_value(value);
 }
 
-
-std::pair<std::vector<scout::token>, std::string> scout::Parser::ConsumeVarOrConst(std::pair<std::vector<token>, std::string> tokenStream, Relation& r)
+// one variable or constant, it ends at the next logic symbol
+static void consumeVarOrConst(relation_cursor& cursor, std::vector<scout::token>& tokens, std::string& numberOrName, scout::SymbolTable& symbols)
 {
-    std::string numberOrName;
+    numberOrName.clear();
     auto isVariable = false;
     auto primed = false;
-    auto succeeded = false;
 
-    for (auto character : tokenStream.second)
+    for (auto character = cursor.Peek(); !cursor.AtEnd(); character = cursor.Peek())
     {
-        if (DIGITS.find(character) != std::string::npos)
+        if (DIGITS.find(character) != std::string_view::npos)
         {
             numberOrName += character;
         }
-        else if (VARIABLE_NAME_SYMBOLS.find(character) != std::string::npos)
+        else if (VARIABLE_NAME_SYMBOLS.find(character) != std::string_view::npos)
         {
             numberOrName += character;
             isVariable = true;
@@ -104,18 +72,15 @@ std::pair<std::vector<scout::token>, std::string> scout::Parser::ConsumeVarOrCon
             }
             primed = true;
         }
-        else if (LOGIC_SYMBOLS.find(character) != std::string::npos)
+        else if (LOGIC_SYMBOLS.find(character) != std::string_view::npos)
         {
-            succeeded = true;
+            break;
         }
         else
         {
             throw std::invalid_argument("Character not allowed: ");
         }
-        if (succeeded)
-        {
-            break;
-        }
+        cursor.Advance();
     }
     if (numberOrName.length() == 0)
     {
@@ -123,109 +88,151 @@ std::pair<std::vector<scout::token>, std::string> scout::Parser::ConsumeVarOrCon
     }
     if (!isVariable)
     {
-        auto number = std::stoi(numberOrName);
-
-        tokenStream.first.emplace_back(token{token::CONST, variable{.factor = number}});
-        tokenStream.second.erase(0, numberOrName.length());
-        return tokenStream;
+        tokens.emplace_back(scout::token{scout::token::CONST, scout::variable{.factor = parseConstant(numberOrName)}});
+        return;
     }
 
-    // has to be a isVariable here
-    int number = 0;
-    for (auto const& pair : r.GetVariableMap())
+    tokens.emplace_back(scout::token{scout::token::VAR, scout::variable{numberOrName, symbols.Intern(numberOrName), primed, 1}});
+}
+
+// one logic symbol, <=, >= and && take two characters
+static void consumeSymbol(relation_cursor& cursor, std::vector<scout::token>& tokens)
+{
+    auto symbol = cursor.Peek();
+    cursor.Advance();
+    switch (symbol)
     {
-        if (pair.second == numberOrName)
+    case '+':
+        tokens.emplace_back(scout::token{scout::token::PLUS, scout::variable{.factor = 1}});
+        break;
+    case '-':
+        tokens.emplace_back(scout::token{scout::token::MINUS});
+        break;
+    case '*':
+        tokens.emplace_back(scout::token{scout::token::MUL});
+        break;
+    case '/':
+        tokens.emplace_back(scout::token{scout::token::DIV});
+        break;
+    case '<':
+        if (cursor.Peek() == '=')
+        {
+            tokens.emplace_back(scout::token{scout::token::SMALLER_EQ});
+            cursor.Advance();
+        }
+        else
+        {
+            tokens.emplace_back(scout::token{scout::token::SMALLER});
+        }
+        break;
+    case '>':
+        if (cursor.Peek() == '=')
         {
-            number = pair.first;
+            tokens.emplace_back(scout::token{scout::token::GREATER_EQ});
+            cursor.Advance();
         }
+        else
+        {
+            tokens.emplace_back(scout::token{scout::token::GREATER});
+        }
+        break;
+    case '=':
+        tokens.emplace_back(scout::token{scout::token::EQUALS});
+        break;
+    case '&':
+        if (cursor.Peek() != '&')
+        {
+            throw std::invalid_argument("No singular \'&\' allowed");
+        }
+        tokens.emplace_back(scout::token{scout::token::LAND});
+        cursor.Advance();
+        break;
+    default:
+        break;
     }
-    if (number == 0)
+}
+
+scout::Relation scout::Parser::RetrieveRelation(std::string const& filePath)
+{
+    MappedFile file(filePath);
+    return Parser::ParseRelation(Parser::ExtractRelation(file.Text()));
+}
+
+scout::Relation scout::Parser::ParseRelation(std::string_view relation)
+{
+    std::vector<token> tokens;
+    return Parser::ParseRelation(relation, tokens);
+}
+
+scout::Relation scout::Parser::ParseRelation(std::string_view relation, std::vector<token>& tokens)
+{
+    Relation r;
+    StatsScope scope(r.GetStats());
+    std::vector<conjunct> tokenizedFormula;
     {
-        auto newMap = r.GetVariableMap();
-        number = (int)newMap.size() + 1;
-        newMap.emplace(number, numberOrName);
-        r.SetVariableMap(newMap);
+        PhaseTimer timer(r.GetStats().parseSeconds);
+        Parser::TokenizeRelation(relation, r, tokens);
+        tokenizedFormula = Parser::MakeFormula(tokens);
+        tokenizedFormula = Parser::AddTokens(tokenizedFormula);
+        tokenizedFormula = Parser::NormalizeTokens(tokenizedFormula);
+        r.SetIsOctagonal(Parser::VerifyValidity(tokenizedFormula));
     }
+    {
+        PhaseTimer timer(r.GetStats().initialClosureSeconds);
+        Parser::MakeRelation(tokenizedFormula, r);
+    }
+    return r;
+}
 
-    tokenStream.first.emplace_back(token{token::VAR, variable{numberOrName, number, primed, 1}});
-    tokenStream.second.erase(0, numberOrName.length() + primed);
+std::string scout::Parser::ReadRelation(std::string const& filePath)
+{
+    MappedFile file(filePath);
+    std::string relation;
+    for (auto character : ExtractRelation(file.Text()))
+    {
+        if (!isIgnored(character))
+        {
+            relation += character;
+        }
+    }
+    return relation;
+}
 
-    return tokenStream;
+std::string_view scout::Parser::ExtractRelation(std::string_view input)
+{
+    auto begin = input.find(':');
+    if (begin == std::string_view::npos)
+    {
+        return {};
+    }
+    auto end = input.find(';', begin + 1);
+    return input.substr(begin + 1, end == std::string_view::npos ? std::string_view::npos : end - (begin + 1));
+}
+
+std::vector<scout::token> scout::Parser::TokenizeRelation(std::string_view relation, Relation& r)
+{
+    std::vector<token> tokens;
+    TokenizeRelation(relation, r, tokens);
+    return tokens;
 }
 
-std::pair<std::vector<scout::token>, std::string> scout::Parser::ConsumeSymbol(std::pair<std::vector<token>, std::string> tokenStream)
+void scout::Parser::TokenizeRelation(std::string_view relation, Relation& r, std::vector<token>& tokens)
 {
-    int eraseLength = 0;
-    auto failed = false;
-    for (auto i = 0; i < tokenStream.second.length() && !failed; ++i)
+    tokens.clear();
+    std::string numberOrName;
+
+    relation_cursor cursor{relation};
+    while (!cursor.AtEnd())
     {
-        switch (tokenStream.second[i])
+        if (LOGIC_SYMBOLS.find(cursor.Peek()) != std::string_view::npos)
         {
-        case '+':
-            tokenStream.first.emplace_back(token{token::PLUS, variable{.factor = 1}});
-            break;
-        case '-':
-            tokenStream.first.emplace_back(token{token::MINUS});
-            break;
-        case '*':
-            tokenStream.first.emplace_back(token{token::MUL});
-            break;
-        case '/':
-            tokenStream.first.emplace_back(token{token::DIV});
-            break;
-        case '<':
-            if (tokenStream.second[i + 1] == '=')
-            {
-                tokenStream.first.emplace_back(token{token::SMALLER_EQ});
-                ++i;
-                ++eraseLength;
-            }
-            else
-            {
-                tokenStream.first.emplace_back(token{token::SMALLER});
-            }
-            break;
-        case '>':
-            if (tokenStream.second[i + 1] == '=')
-            {
-                tokenStream.first.emplace_back(token{token::GREATER_EQ});
-                ++i;
-                ++eraseLength;
-            }
-            else
-            {
-                tokenStream.first.emplace_back(token{token::GREATER});
-            }
-            break;
-        case '=':
-            tokenStream.first.emplace_back(token{token::EQUALS});
-            break;
-        case '&':
-            if (tokenStream.second[i + 1] == '&')
-            {
-                tokenStream.first.emplace_back(token{token::LAND});
-                ++i;
-                ++eraseLength;
-            }
-            else
-            {
-                throw std::invalid_argument("No singular \'&\' allowed");
-            }
-            break;
-        default:
-            failed = true;
-            break;
+            consumeSymbol(cursor, tokens);
         }
-        if (!failed)
+        else
         {
-            ++eraseLength;
+            consumeVarOrConst(cursor, tokens, numberOrName, r.GetSymbolTable());
         }
     }
-    if (eraseLength != 0)
-    {
-        tokenStream.second.erase(0, eraseLength);
-    }
-    return tokenStream;
 }
 
 
@@ -431,7 +438,7 @@ std::vector<scout::conjunct> scout::Parser::AddTokens(std::vector<conjunct> cons
             {
                 if (v.name == conjunct[j].name && v.primed == conjunct[j].primed)
                 {
-                    v.factor += conjunct[j].factor;
+                    v.factor = TermSum(v.factor, conjunct[j].factor);
                 }
             }
             if (v.factor != 0 || !v.name)
@@ -502,7 +509,7 @@ std::vector<scout::conjunct> scout::Parser::NormalizeTokens(std::vector<conjunct
     variable var1;
     variable var2;
     variable constant;
-    int highestFactor;
+    term_value highestFactor;
 
     for (auto const& conjunct : tokenizedFormula)
     {
@@ -526,7 +533,7 @@ std::vector<scout::conjunct> scout::Parser::NormalizeTokens(std::vector<conjunct
         if (!var2.name)
         {
             var2 = var1;
-            constant.factor *= 2;
+            constant.factor = TermProduct(constant.factor, 2);
         }
         var1.factor = var1.factor % highestFactor == 0 ? var1.factor / highestFactor : throw std::invalid_argument("Can't Normalize Variable Factors.");
         var2.factor = var2.factor % highestFactor == 0 ? var2.factor / highestFactor : throw std::invalid_argument("Can't Normalize Variable Factors.");
@@ -544,13 +551,8 @@ std::vector<scout::conjunct> scout::Parser::NormalizeTokens(std::vector<conjunct
 
 void scout::Parser::MakeRelation(std::vector<conjunct> const& tokenizedFormula, Relation& r)
 {
-    int size = r.GetIsOctagonal() ? 4 * (int)r.GetVariableMap().size() : 2 * (int)r.GetVariableMap().size();
-    std::vector<cell> row(size);
-    matrix m;
-    for (int i = 0; i < size; ++i)
-    {
-        m.emplace_back(row);
-    }
+    int size = r.GetIsOctagonal() ? 4 * r.GetSymbolTable().Size() : 2 * r.GetSymbolTable().Size();
+    matrix m(size);
     for (auto const& conjunct : tokenizedFormula)
     {
         if (!r.GetIsOctagonal())
@@ -566,8 +568,7 @@ void scout::Parser::MakeRelation(std::vector<conjunct> const& tokenizedFormula,
                 posJ = *conjunct[0].number + *conjunct[0].primed * size / 2 - 1;
                 posI = *conjunct[1].number + *conjunct[1].primed * size / 2 - 1;
             }
-            auto weight = {std::make_pair(0, conjunct[2].factor)};
-            m[posI][posJ] = weight;
+            m.Assign(posI, posJ, {std::make_pair(0, conjunct[2].factor)});
             continue;
         }
 
@@ -580,14 +581,14 @@ void scout::Parser::MakeRelation(std::vector<conjunct> const& tokenizedFormula,
         int posJTwo = conjunct[0].factor > 0 ? 2 * *conjunct[0].number - 1 + *conjunct[0].primed * size / 2
                                              : 2 * *conjunct[0].number - 2 + *conjunct[0].primed * size / 2;
 
-        auto weight = {std::make_pair(0, conjunct[2].factor)};
+        auto weight = std::make_pair(0, conjunct[2].factor);
 
-        m[posIOne][posJOne] = weight;
-        m[posITwo][posJTwo] = weight;
+        m.Assign(posIOne, posJOne, {weight});
+        m.Assign(posITwo, posJTwo, {weight});
     }
     for (int i = 0; i < size; ++i)
     {
-        m[i][i] = {std::make_pair(0, 0)};
+        m.Assign(i, i, {std::make_pair(0, 0)});
     }
     //    MatrixOperations::PrintMatrix(m);
     //    r.transitiveClosure = {m};
@@ -598,5 +599,5 @@ void scout::Parser::MakeRelation(std::vector<conjunct> const& tokenizedFormula,
     // r.settest(m);
     // std::cout << std::endl;
 
-    r.AddPowerOfRelation(1, m);
+    r.AddPowerOfRelation(1, std::move(m));
 }
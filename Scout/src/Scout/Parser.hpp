@@ -5,6 +5,7 @@
 #include <optional>
 #include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "Common.hpp"
@@ -18,7 +19,7 @@ struct variable
     std::optional<std::string> name;
     std::optional<int> number;
     std::optional<bool> primed;
-    int factor;
+    term_value factor;
 };
 
 struct token
@@ -48,18 +49,23 @@ namespace Parser
 // Wrapper function of the parser
 Relation RetrieveRelation(std::string const& filePath);
 
+// the whole pipeline from the formula text (without name, : and ;) to the closed R^1
+Relation ParseRelation(std::string_view relation);
+
+// ParseRelation with a reused token buffer, see TokenizeRelation
+Relation ParseRelation(std::string_view relation, std::vector<token>& tokens);
+
 // Filters out the relation in between first : and ; of a file
 std::string ReadRelation(std::string const& filePath);
 
-// Converts string into token format
-std::vector<token> TokenizeRelation(std::string const& relation, Relation& r);
-
-// helper functions for TokenizeRelation
-std::pair<std::vector<token>, std::string> ConsumeToken(std::pair<std::vector<token>, std::string> tokenStream, Relation& r);
+// the text in between the first : and the following ; of the file contents input, spaces and line breaks included
+std::string_view ExtractRelation(std::string_view input);
 
-std::pair<std::vector<token>, std::string> ConsumeVarOrConst(std::pair<std::vector<token>, std::string> tokenStream, Relation& r);
+// Converts string into token format. Spaces and line breaks are skipped, the text is scanned once.
+std::vector<token> TokenizeRelation(std::string_view relation, Relation& r);
 
-std::pair<std::vector<token>, std::string> ConsumeSymbol(std::pair<std::vector<token>, std::string> tokenStream);
+// TokenizeRelation into tokens, which is cleared first; reusing tokens avoids reallocating it for every relation
+void TokenizeRelation(std::string_view relation, Relation& r, std::vector<token>& tokens);
 
 // first step of turning tokens into proper form
 std::vector<conjunct> MakeFormula(std::vector<token> const& tokens);
@@ -0,0 +1,167 @@
+#include "PowerPipeline.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <set>
+
+// R^power = R^lower o R^upper
+struct chain_step
+{
+    int power;
+    int lower;
+    int upper;
+};
+
+// the compositions Relation::CalcPowerByAdditionChain makes for power when the powers in cached are cached, in its order
+static void planAdditionChain(int power, std::set<int>& cached, std::vector<chain_step>& steps)
+{
+    if (cached.contains(power))
+    {
+        return;
+    }
+    int lower = *std::prev(cached.lower_bound(power));
+    if (lower < power / 2)
+    {
+        planAdditionChain(power / 2, cached, steps);
+        lower = power / 2;
+    }
+    planAdditionChain(power - lower, cached, steps);
+    steps.push_back({power, lower, power - lower});
+    cached.insert(power);
+}
+
+scout::Relation::PowerPipeline::PowerPipeline(Relation& relation, std::vector<int> const& powers, int lookAhead)
+    : relation(relation), lookAhead(lookAhead)
+{
+    std::set<int> scheduled;
+    for (auto power : powers)
+    {
+        if (!relation.powersOfRelation.contains(power) && scheduled.insert(power).second)
+        {
+            schedule.push_back(power);
+        }
+    }
+    relation.pipeline = this;
+    thread = std::thread(&PowerPipeline::Produce, this);
+}
+
+scout::Relation::PowerPipeline::~PowerPipeline()
+{
+    Stop();
+    relation.pipeline = nullptr;
+}
+
+void scout::Relation::PowerPipeline::Take(int power)
+{
+    if (relation.powersOfRelation.contains(power))
+    {
+        return;
+    }
+    std::unique_lock lock(mutex);
+    // powers of the schedule that came with the chain of an earlier one
+    while (next < schedule.size() && relation.powersOfRelation.contains(schedule[next]))
+    {
+        ++next;
+    }
+    if (stop || next == schedule.size() || schedule[next] != power)
+    {
+        lock.unlock();
+        Stop();
+        return;
+    }
+    changed.wait(lock, [this] { return failed || done > next; });
+    if (failed)
+    {
+        lock.unlock();
+        Stop();
+        return;
+    }
+    // the chain of power is in front of the powers computed ahead and ends with power
+    auto end = std::next(std::find_if(computed.begin(), computed.end(), [power](auto const& c) { return c.power == power; }));
+    for (auto it = computed.begin(); it != end; ++it)
+    {
+        relation.CachePower(it->power, std::move(it->m));
+    }
+    computed.erase(computed.begin(), end);
+    ++next;
+    changed.notify_all();
+}
+
+void scout::Relation::PowerPipeline::Produce()
+{
+    StatsScope scope(stats);
+    std::unique_lock lock(mutex);
+    while (true)
+    {
+        changed.wait(lock, [this] { return stop || (done < schedule.size() && done < next + std::size_t(lookAhead)); });
+        if (stop)
+        {
+            return;
+        }
+
+        // the cached powers at the time the round asks for schedule[done]
+        std::set<int> cached;
+        for (auto const& entry : relation.powersOfRelation)
+        {
+            cached.insert(entry.first);
+        }
+        for (auto const& c : computed)
+        {
+            cached.insert(c.power);
+        }
+        std::vector<chain_step> steps;
+        planAdditionChain(schedule[done], cached, steps);
+
+        auto find = [this](int power)
+        {
+            auto it = std::find_if(computed.begin(), computed.end(), [power](auto const& c) { return c.power == power; });
+            return it != computed.end() ? it->m : relation.powersOfRelation.at(power).m;
+        };
+        for (auto const& step : steps)
+        {
+            auto lower = find(step.lower);
+            auto upper = find(step.upper);
+            lock.unlock();
+            shared_matrix m;
+            try
+            {
+                PhaseTimer timer(stats.powersSeconds);
+                m = std::make_shared<matrix const>(MatrixOperations::ComposeClosed(*lower, *upper, relation.isOctagonal));
+            }
+            catch (...)
+            {
+                // the round computes the power itself and runs into the same error there
+                lock.lock();
+                failed = true;
+                changed.notify_all();
+                return;
+            }
+            lock.lock();
+            if (stop)
+            {
+                return;
+            }
+            computed.push_back({step.power, std::move(m)});
+        }
+        ++done;
+        changed.notify_all();
+    }
+}
+
+void scout::Relation::PowerPipeline::Stop()
+{
+    {
+        std::lock_guard lock(mutex);
+        stop = true;
+    }
+    changed.notify_all();
+    if (thread.joinable())
+    {
+        thread.join();
+        if constexpr (COLLECT_STATS)
+        {
+            relation.stats.Merge(stats);
+        }
+    }
+    computed.clear();
+}
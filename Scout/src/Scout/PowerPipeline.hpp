@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Relation.hpp"
+
+namespace scout
+{
+// Computes the powers a round of Relation::CalculateTransitiveClosure is going to ask for on a thread of its own, at most
+// lookAhead of them ahead of the round. Each power is built by the addition chain CalcPowerByAdditionChain would use and
+// only enters the power cache when the round asks for it, together with the powers of its chain, so the cache ends up
+// exactly as without the pipeline. If the round asks for anything else the pipeline stops and drops what it has.
+class Relation::PowerPipeline
+{
+public:
+    // powers in the order the round asks for them; relation.pipeline points to this pipeline for its lifetime
+    PowerPipeline(Relation& relation, std::vector<int> const& powers, int lookAhead);
+    // stops the thread once its current composition is done
+    ~PowerPipeline();
+
+    PowerPipeline(PowerPipeline const&) = delete;
+    PowerPipeline& operator=(PowerPipeline const&) = delete;
+
+    // Moves power and the rest of its chain into the cache, waiting for the thread if it is not done yet. If power is not
+    // the next power of the round the pipeline stops and leaves power to the caller.
+    void Take(int power);
+
+private:
+    struct computed_power
+    {
+        int power;
+        shared_matrix m;
+    };
+
+    void Produce();
+
+    // ends the thread and drops the powers that were not taken
+    void Stop();
+
+    Relation& relation;
+    int lookAhead;
+
+    // The thread only reads the cache of the relation, and only while holding mutex. The round changes the cache under
+    // mutex while the thread runs and on its own once it is stopped.
+    std::mutex mutex;
+    std::condition_variable changed;
+    // uncached powers of the round, in the order it asks for them
+    std::vector<int> schedule;
+    // schedule[next] is the power the round asks for next, the chains of schedule[0, done) are computed
+    std::size_t next = 0;
+    std::size_t done = 0;
+    // computed and not yet taken, in the order they were computed
+    std::vector<computed_power> computed;
+    bool stop = false;
+    bool failed = false;
+    // the compositions of the thread
+    ClosureStats stats;
+
+    std::thread thread;
+};
+} // namespace scout
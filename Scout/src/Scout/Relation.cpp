@@ -1,94 +1,329 @@
 #include "Relation.hpp"
+#include "Canonical.hpp"
+#include "MappedFile.hpp"
+#include "PowerPipeline.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <type_traits>
 #include <utility>
 
+// a bound on k from term values; larger bounds are beyond any power the loop can reach
+static int boundToInt(scout::term_value value) { return int(std::clamp<scout::term_value>(value, std::numeric_limits<int>::min(), std::numeric_limits<int>::max())); }
+
 void scout::Relation::CalculateTransitiveClosure()
 {
+    if (this->cacheDirectory)
+    {
+        CalculateCachedTransitiveClosure();
+        return;
+    }
+    StatsScope scope(stats);
+    PhaseTimer timer(stats.transitiveClosureSeconds);
     int b = 1;
     int b_jump = 1;
     while (true)
     {
-        std::optional<int> K;
-        for (int c = 1; c <= b; ++c)
+        CheckDeadline();
+        RecordStats([](ClosureStats& stats) { ++stats.iterations; });
+        // the powers this round asks for in the order it does, computed ahead on the pipeline thread
+        std::optional<PowerPipeline> roundPipeline;
+        if (this->powerLookAhead > 0 && this->powerCacheBudget == 0)
+        {
+            std::vector<int> powers;
+            for (int c = 1; c <= b; ++c)
+            {
+                for (int l = 0; l <= 2; ++l)
+                {
+                    powers.push_back(b + l * c);
+                }
+            }
+            roundPipeline.emplace(*this, powers, this->powerLookAhead);
+        }
+        // the candidates c of a window are evaluated at the same time and committed in the order of c
+        auto window = this->speculativeCandidates ? MatrixOperations::GetThreadCount() : 1;
+        for (int first = 1; first <= b; first += window)
         {
-            for (int l = 0; l <= 2; ++l)
+            auto last = std::min(b, first + window - 1);
+            std::vector<candidate_powers> powers;
+            // b + l * c of the first inconsistent power, the candidates before it are still committed
+            std::optional<int> inconsistentPower;
+            for (int c = first; c <= last && !inconsistentPower; ++c)
             {
-                CalcAddPowerOfRelation(b + l * c);
-                if (!ConsistencyCheck(powersOfRelation[b + l * c]))
+                candidate_powers candidate;
+                for (int l = 0; l <= 2; ++l)
                 {
-                    if (b == 1)
+                    auto power = GetConsistentPowerOfRelation(b + l * c);
+                    if (!power)
                     {
-                        this->transitiveClosure.emplace_back(this->powersOfRelation[1]);
-                        ++prefix;
+                        inconsistentPower = b + l * c;
+                        break;
                     }
-                    for (int i = b + 1; i < b + l * c; ++i)
+                    (l == 0 ? candidate.b : l == 1 ? candidate.bc : candidate.b2c) = std::move(power);
+                }
+                if (!inconsistentPower)
+                {
+                    if (window > 1)
                     {
-                        CalcAddPowerOfRelation(i);
-                        this->transitiveClosure.emplace_back(this->powersOfRelation[i]);
-                        ++this->prefix;
+                        // MaxPeriodic needs R^c and the cache must not change while the window runs
+                        candidate.c = GetPowerOfRelation(c);
                     }
-                    return;
+                    powers.push_back(std::move(candidate));
                 }
             }
-            auto Lambda = MatrixOperations::IntegerMatrixSubtraction(powersOfRelation[b + c], powersOfRelation[b]);
-            if (Lambda == MatrixOperations::IntegerMatrixSubtraction(powersOfRelation[b + 2 * c], powersOfRelation[b + c]))
-            {
-                auto LambdaB = MatrixOperations::MatrixAddition(powersOfRelation[b], Lambda);
-                LambdaB = MatrixOperations::ParametricFloydWarshallAlgorithm(LambdaB, false);
 
-                K = MaxConsistent(b, LambdaB);
-
-                std::optional<int> L = MaxPeriodic(LambdaB, c);
-                if (K)
+            std::vector<period_candidate> results(powers.size());
+            if (window == 1 && !powers.empty())
+            {
+                results[0] = EvaluateCandidate(b, first, powers[0], stats);
+            }
+            else if (!powers.empty())
+            {
+                std::vector<ClosureStats> candidateStats(powers.size());
+                MatrixOperations::GetThreadPool().ParallelFor(int(powers.size()),
+                                                              [&](int index, int)
+                                                              {
+                                                                  StatsScope scope(candidateStats[index]);
+                                                                  results[index] = EvaluateCandidate(b, first + index, powers[index], candidateStats[index]);
+                                                              });
+                if constexpr (COLLECT_STATS)
                 {
-                    if (L)
+                    for (auto const& candidate : candidateStats)
                     {
-                        L = std::min(*K, *L);
-                        L = *L == 0 ? 2 : *L;
-                    }
-                    else
-                    {
-                        L = *K;
+                        stats.Merge(candidate);
                     }
                 }
+            }
 
-                if (!L)
+            for (std::size_t index = 0; index < results.size(); ++index)
+            {
+                auto c = first + int(index);
+                auto& result = results[index];
+                RecordStats([](ClosureStats& stats) { ++stats.candidates; });
+                if (!result.LambdaB)
                 {
-                    this->transitiveClosure.emplace_back(LambdaB);
+                    continue;
+                }
+                if (!result.L)
+                {
+                    auto const& closedLambdaB = *this->transitiveClosure.emplace_back(std::make_shared<matrix const>(std::move(*result.LambdaB)));
                     for (int j = 1; j < c; ++j)
                     {
-                        CalcAddPowerOfRelation(j);
-                        matrix LambdaBJ = MatrixOperations::MatrixComposition(LambdaB, this->powersOfRelation[j], true);
-                        LambdaBJ = MatrixOperations::CalcExtremalPaths(LambdaBJ);
-                        this->transitiveClosure.emplace_back(LambdaBJ);
+                        auto LambdaBJ = MatrixOperations::ComposeClosed(closedLambdaB, *GetPowerOfRelation(j), true);
+                        this->transitiveClosure.emplace_back(std::make_shared<matrix const>(std::move(LambdaBJ)));
                     }
                     return;
                 }
-                b_jump = std::max(b_jump, b + c * (*L + 1));
+                b_jump = std::max(b_jump, b + c * (*result.L + 1));
+            }
+
+            if (inconsistentPower)
+            {
+                if (b == 1)
+                {
+                    this->transitiveClosure.emplace_back(GetPowerOfRelation(1));
+                    ++prefix;
+                }
+                for (int i = b + 1; i < *inconsistentPower; ++i)
+                {
+                    this->transitiveClosure.emplace_back(GetPowerOfRelation(i));
+                    ++this->prefix;
+                }
+                return;
             }
         }
+        roundPipeline.reset();
         int b_next = std::max(b + 1, b_jump);
+        if (b_next > b + 1)
+        {
+            RecordStats([](ClosureStats& stats) { ++stats.jumps; });
+        }
         for (int i = b; i < b_next; ++i)
         {
-            CalcAddPowerOfRelation(i);
-            this->transitiveClosure.emplace_back(this->powersOfRelation[i]);
+            this->transitiveClosure.emplace_back(GetPowerOfRelation(i));
             ++this->prefix;
         }
         b = std::max(b + 1, b_jump);
     }
 }
 
+scout::Relation::period_candidate scout::Relation::EvaluateCandidate(int b, int c, candidate_powers const& powers, ClosureStats& candidateStats)
+{
+    period_candidate result;
+    {
+        PhaseTimer lambdaTimer(candidateStats.lambdaSeconds);
+        if (!MayHaveEqualDifferences(b, c))
+        {
+            RecordStats([](ClosureStats& stats) { ++stats.candidatesFiltered; });
+            return result;
+        }
+        auto Lambda = MatrixOperations::IntegerMatrixSubtraction(*powers.bc, *powers.b);
+        if (!(Lambda == MatrixOperations::IntegerMatrixSubtraction(*powers.b2c, *powers.bc)))
+        {
+            return result;
+        }
+        result.LambdaB = MatrixOperations::MatrixAddition(*powers.b, Lambda);
+        MatrixOperations::CloseInPlace(*result.LambdaB, false);
+    }
+
+    std::optional<int> K;
+    {
+        PhaseTimer maxConsistentTimer(candidateStats.maxConsistentSeconds);
+        K = MaxConsistent(b, *result.LambdaB);
+    }
+    std::optional<int> L;
+    {
+        PhaseTimer maxPeriodicTimer(candidateStats.maxPeriodicSeconds);
+        L = MaxPeriodic(*result.LambdaB, powers.c ? *powers.c : *GetPowerOfRelation(c));
+    }
+    if (K)
+    {
+        if (L)
+        {
+            L = std::min(*K, *L);
+            L = *L == 0 ? 2 : *L;
+        }
+        else
+        {
+            L = *K;
+        }
+    }
+    result.L = L;
+    return result;
+}
+
+void scout::Relation::SetSpeculativeCandidates(bool enabled) { this->speculativeCandidates = enabled; }
+
+void scout::Relation::SetPowerLookAhead(int powers) { this->powerLookAhead = powers; }
+
+void scout::Relation::SetDeadline(std::chrono::steady_clock::time_point deadline) { this->deadline = deadline; }
+
+void scout::Relation::SetCacheDirectory(std::filesystem::path directory) { this->cacheDirectory = std::move(directory); }
+
+// creates an empty file next to path that no other writer uses, the way mkstemp does: the name gets a random part and
+// the file is only created if it did not exist
+static std::filesystem::path createTemporaryFile(std::filesystem::path const& path)
+{
+    std::random_device random;
+    for (int attempt = 0; attempt < 100; ++attempt)
+    {
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), ".%08x%08x.tmp", unsigned(random()), unsigned(random()));
+        auto temporary = path;
+        temporary += suffix;
+        if (auto* file = std::fopen(temporary.string().c_str(), "wbx"))
+        {
+            std::fclose(file);
+            return temporary;
+        }
+        if (errno != EEXIST)
+        {
+            break;
+        }
+    }
+    throw std::runtime_error("Cannot create a temporary file for " + path.string());
+}
+
+void scout::Relation::CalculateCachedTransitiveClosure()
+{
+    auto relation = GetPowerOfRelation(1);
+    auto order = Canonical::VariableOrder(*relation, this->isOctagonal);
+
+    Relation canonical;
+    canonical.isOctagonal = this->isOctagonal;
+    for (std::size_t k = 0; k < order.size(); ++k)
+    {
+        canonical.symbols.Intern("v" + std::to_string(k + 1));
+    }
+    canonical.AddPowerOfRelation(1, Canonical::PermuteVariables(*relation, order, this->isOctagonal));
+    auto canonicalRelation = canonical.GetPowerOfRelation(1);
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.scout", static_cast<unsigned long long>(Canonical::Hash(*canonicalRelation, this->isOctagonal)));
+    auto file = *this->cacheDirectory / name;
+
+    std::optional<Relation> cached;
+    if (std::filesystem::exists(file))
+    {
+        try
+        {
+            cached = Load(file.string());
+        }
+        catch (std::exception const&)
+        {
+            // written by another version or corrupt, it is replaced below
+        }
+        // the hash only picks the file, a hit needs the same relation
+        if (cached && (cached->isOctagonal != this->isOctagonal || !(*cached->GetPowerOfRelation(1) == *canonicalRelation)))
+        {
+            cached.reset();
+        }
+    }
+    if (!cached)
+    {
+        canonical.deadline = this->deadline;
+        canonical.powerCacheBudget = this->powerCacheBudget;
+        canonical.speculativeCandidates = this->speculativeCandidates;
+        canonical.powerLookAhead = this->powerLookAhead;
+        canonical.stats = this->stats;
+        canonical.CalculateTransitiveClosure();
+        this->stats = canonical.stats;
+
+        // written to a file of its own and renamed, so concurrent readers never see a partial file
+        std::filesystem::path temporary;
+        try
+        {
+            std::filesystem::create_directories(*this->cacheDirectory);
+            temporary = createTemporaryFile(file);
+            canonical.Save(temporary.string());
+            std::filesystem::rename(temporary, file);
+        }
+        catch (std::exception const&)
+        {
+            // a cache that cannot be written only costs the next run the closure, this one has it already
+            std::error_code ignored;
+            std::filesystem::remove(temporary, ignored);
+        }
+        cached = std::move(canonical);
+    }
+
+    auto inverse = Canonical::InvertOrder(order);
+    this->transitiveClosure.clear();
+    for (auto const& part : cached->transitiveClosure)
+    {
+        this->transitiveClosure.emplace_back(std::make_shared<matrix const>(Canonical::PermuteVariables(*part, inverse, this->isOctagonal)));
+    }
+    this->prefix = cached->prefix;
+}
+
+scout::ClosureStats const& scout::Relation::GetStats() const { return this->stats; }
+
+scout::ClosureStats& scout::Relation::GetStats() { return this->stats; }
 
-std::optional<int> scout::Relation::MaxConsistent(int b, matrix LambdaB)
+void scout::Relation::CheckDeadline() const
+{
+    if (this->deadline && std::chrono::steady_clock::now() >= *this->deadline)
+    {
+        throw ClosureTimeout("Transitive closure exceeded its deadline");
+    }
+}
+
+std::optional<int> scout::Relation::MaxConsistent(int b, matrix const& LambdaB)
 {
     int const l = 2;
     std::optional<int> minGammaDB;
     std::optional<int> gamma;
-    auto size = LambdaB.size();
+    auto size = LambdaB.Size();
     for (int i = 0; i < size; ++i)
     {
-        for (auto const& term : LambdaB[i][i])
+        for (auto const& term : LambdaB(i, i))
         {
             gamma = ParametricConsistencyCheck(term.first, term.second);
             if (!gamma)
@@ -108,12 +343,12 @@ std::optional<int> scout::Relation::MaxConsistent(int b, matrix LambdaB)
         return minGammaDB;
     }
 
-    std::set<std::pair<int, int>> L;
-    std::set<std::pair<int, int>> U;
+    std::set<term> L;
+    std::set<term> U;
     for (int i = 0; i < size; ++i)
     {
-        auto cell1 = LambdaB[i][MatrixOperations::IDash(i)];
-        auto cell2 = LambdaB[MatrixOperations::IDash(i)][i];
+        auto cell1 = LambdaB(i, MatrixOperations::IDash(i));
+        auto cell2 = LambdaB(MatrixOperations::IDash(i), i);
         if (cell1.empty() || cell2.empty())
         {
             continue;
@@ -122,9 +357,9 @@ std::optional<int> scout::Relation::MaxConsistent(int b, matrix LambdaB)
         {
             for (auto const& term_j : cell2)
             {
-                L.emplace(term_i.first + term_j.first, MatrixOperations::HalfInt(term_i.second) + MatrixOperations::HalfInt(term_j.second));
-                U.emplace(term_i.first + term_j.first,
-                          MatrixOperations::HalfInt(term_i.first + term_i.second) + MatrixOperations::HalfInt(term_j.first + term_j.second));
+                L.emplace(TermSum(term_i.first, term_j.first), TermSum(MatrixOperations::HalfInt(term_i.second), MatrixOperations::HalfInt(term_j.second)));
+                U.emplace(TermSum(term_i.first, term_j.first), TermSum(MatrixOperations::HalfInt(TermSum(term_i.first, term_i.second)),
+                                                                       MatrixOperations::HalfInt(TermSum(term_j.first, term_j.second))));
             }
         }
     }
@@ -181,16 +416,16 @@ std::optional<int> scout::Relation::MaxConsistent(int b, matrix LambdaB)
     return minGamma;
 }
 
-std::optional<int> scout::Relation::MaxPeriodic(matrix const& LambdaB, int c)
+std::optional<int> scout::Relation::MaxPeriodic(matrix const& LambdaB, int c) { return MaxPeriodic(LambdaB, *GetPowerOfRelation(c)); }
+
+std::optional<int> scout::Relation::MaxPeriodic(matrix const& LambdaB, matrix const& powerC) const
 {
     auto const l = 0;
-    CalcAddPowerOfRelation(c);
-    auto LambdaBC = MatrixOperations::MatrixComposition(LambdaB, this->powersOfRelation[c], false);
+    auto LambdaBC = MatrixOperations::ComposeClosed(LambdaB, powerC, false);
     std::optional<int> kappa;
 
     if (!this->isOctagonal)
     {
-        LambdaBC = MatrixOperations::CalcExtremalPaths(LambdaBC);
         auto ret = CheckPeriod(LambdaB, LambdaBC, l);
         if (ret)
         {
@@ -199,58 +434,60 @@ std::optional<int> scout::Relation::MaxPeriodic(matrix const& LambdaB, int c)
         return ret;
     }
 
-    auto size = LambdaBC.size();
-    auto size2 = LambdaB.size();
+    auto size = LambdaBC.Size();
     matrix M_1_L = LambdaBC;
     matrix M_1_U = LambdaBC;
     matrix M_2_L = LambdaB;
     matrix M_2_U = LambdaB;
 
+    cell minTermsL;
+    cell minTermsU;
     for (int i = 0; i < size; ++i)
     {
         for (int j = 0; j < size; ++j)
         {
-            auto cell0 = LambdaBC[i][j];
-            auto cell1 = LambdaBC[i][MatrixOperations::IDash(i)];
-            auto cell2 = LambdaBC[MatrixOperations::IDash(j)][j];
-            std::set<std::pair<int, int>> minTermsL;
-            std::set<std::pair<int, int>> minTermsU;
+            auto cell0 = LambdaBC(i, j);
+            auto cell1 = LambdaBC(i, MatrixOperations::IDash(i));
+            auto cell2 = LambdaBC(MatrixOperations::IDash(j), j);
+            minTermsL.clear();
+            minTermsU.clear();
             for (auto const& term : cell0)
             {
                 // Split univariate cell_ij into L and U using Lemma 4.23
-                minTermsL.emplace(2 * term.first, term.second);
-                minTermsU.emplace(2 * term.first, term.first + term.second);
+                minTermsL.emplace_back(TermProduct(2, term.first), term.second);
+                minTermsU.emplace_back(TermProduct(2, term.first), TermSum(term.first, term.second));
             }
             for (auto const& term_i : cell1)
             {
                 for (auto const& term_j : cell2)
                 {
                     // Add Halfterms in cell_ii' + cell_j'j using Lemma 4.23
-                    minTermsL.emplace(term_i.first + term_j.first, MatrixOperations::HalfInt(term_i.second) + MatrixOperations::HalfInt(term_j.second));
-                    minTermsU.emplace(term_i.first + term_j.first,
-                                      MatrixOperations::HalfInt(term_i.first + term_i.second) + MatrixOperations::HalfInt(term_j.first + term_j.second));
+                    minTermsL.emplace_back(TermSum(term_i.first, term_j.first),
+                                           TermSum(MatrixOperations::HalfInt(term_i.second), MatrixOperations::HalfInt(term_j.second)));
+                    minTermsU.emplace_back(TermSum(term_i.first, term_j.first), TermSum(MatrixOperations::HalfInt(TermSum(term_i.first, term_i.second)),
+                                                                                        MatrixOperations::HalfInt(TermSum(term_j.first, term_j.second))));
                 }
             }
             // ensure only min terms remain in both cells
-            M_1_L[i][j] = MatrixOperations::MinCell(minTermsL);
-            M_1_U[i][j] = MatrixOperations::MinCell(minTermsU);
+            MatrixOperations::ReduceToMinTerms(minTermsL);
+            MatrixOperations::ReduceToMinTerms(minTermsU);
+            M_1_L.Assign(i, j, minTermsL);
+            M_1_U.Assign(i, j, minTermsU);
         }
     }
 
-    M_1_L = MatrixOperations::CalcExtremalPaths(M_1_L);
-    M_1_U = MatrixOperations::CalcExtremalPaths(M_1_U);
-
-    for (int i = 0; i < size2; ++i)
+    for (int i = 0; i < size; ++i)
     {
-        for (int j = 0; j < size2; ++j)
+        for (int j = 0; j < size; ++j)
         {
             // M2 is already tightly closed, we just split it into L and U using Lemma 4.23
-            if (LambdaB[i][j].empty())
+            auto lambda = LambdaB(i, j);
+            if (lambda.empty())
             {
                 continue;
             }
-            M_2_L[i][j][0] = std::make_pair(2 * LambdaB[i][j][0].first, LambdaB[i][j][0].first + LambdaB[i][j][0].second); //+alpha da l+1
-            M_2_U[i][j][0] = std::make_pair(2 * LambdaB[i][j][0].first, 2 * LambdaB[i][j][0].first + LambdaB[i][j][0].second);
+            M_2_L(i, j)[0] = term(TermProduct(2, lambda[0].first), TermSum(lambda[0].first, lambda[0].second)); //+alpha da l+1
+            M_2_U(i, j)[0] = term(TermProduct(2, lambda[0].first), TermSum(TermProduct(2, lambda[0].first), lambda[0].second));
         }
     }
 
@@ -278,23 +515,23 @@ std::optional<int> scout::Relation::MaxPeriodic(matrix const& LambdaB, int c)
 std::optional<int> scout::Relation::CheckPeriod(matrix const& m1, matrix const& m2, int const l)
 {
     std::optional<int> kappa;
-    auto size = m1.size();
+    auto size = m1.Size();
     for (int i = 0; i < size; ++i)
     {
         for (int j = 0; j < size; ++j)
         {
-            if (m1[i][j].empty())
+            if (m1(i, j).empty())
             {
                 continue;
             }
-            auto t_0 = m1[i][j][0];
-            for (auto t_i : m2[i][j])
+            auto t_0 = m1(i, j)[0];
+            for (auto t_i : m2(i, j))
             {
                 if (t_i.first == t_0.first)
                 {
                     continue;
                 }
-                int candidate = (t_i.second - t_0.second) / (t_0.first - t_i.first);
+                auto candidate = boundToInt(TermDifference(t_i.second, t_0.second) / TermDifference(t_0.first, t_i.first));
                 if (candidate <= l + 1) // needed in case of negative cylce
                     continue;
                 kappa = !kappa ? candidate : std::min(candidate, *kappa);
@@ -304,7 +541,7 @@ std::optional<int> scout::Relation::CheckPeriod(matrix const& m1, matrix const&
     return kappa;
 }
 
-std::pair<int, scout::matrix> scout::Relation::SearchPowerOfRelation(int power)
+std::pair<int, scout::shared_matrix> scout::Relation::SearchPowerOfRelation(int power)
 {
     if (power <= 0)
     {
@@ -313,26 +550,134 @@ std::pair<int, scout::matrix> scout::Relation::SearchPowerOfRelation(int power)
 
     auto lowerBound = this->powersOfRelation.lower_bound(power);
 
-    auto closestPower = lowerBound->first == power ? lowerBound->second : (--lowerBound)->second;
+    auto closestPower = lowerBound != this->powersOfRelation.end() && lowerBound->first == power ? lowerBound->second.m : (--lowerBound)->second.m;
 
     return std::make_pair(lowerBound->first, closestPower);
 }
 
-void scout::Relation::SetVariableMap(std::map<int, std::string> const& variableMap) { this->variableMap = variableMap; }
+scout::SymbolTable const& scout::Relation::GetSymbolTable() const { return this->symbols; }
 
-std::map<int, std::string> scout::Relation::GetVariableMap() { return this->variableMap; }
+scout::SymbolTable& scout::Relation::GetSymbolTable() { return this->symbols; }
 
 void scout::Relation::SetIsOctagonal(bool isOctagonal) { this->isOctagonal = isOctagonal; }
 
 bool scout::Relation::GetIsOctagonal() const { return this->isOctagonal; }
 
-void scout::Relation::AddPowerOfRelation(int power, matrix const& m) { this->powersOfRelation.emplace(power, m); }
+// splitmix64, the weight of a cell in the fingerprints
+static std::uint64_t cellWeight(std::uint64_t index)
+{
+    index += 0x9e3779b97f4a7c15ull;
+    index = (index ^ (index >> 30)) * 0xbf58476d1ce4e5b9ull;
+    index = (index ^ (index >> 27)) * 0x94d049bb133111ebull;
+    return index ^ (index >> 31);
+}
+
+bool scout::Relation::MayHaveEqualDifferences(int b, int c) const
+{
+    auto const& f0 = this->powersOfRelation.at(b).fingerprint;
+    auto const& f1 = this->powersOfRelation.at(b + c).fingerprint;
+    auto const& f2 = this->powersOfRelation.at(b + 2 * c).fingerprint;
+    // IntegerMatrixSubtraction marks the first cell that is empty in only one operand, those go through the full check
+    if (!f0.nonParametric || !f1.nonParametric || !f2.nonParametric || f0.cells != f1.cells || f1.cells != f2.cells)
+    {
+        return true;
+    }
+    // equal differences R^(b+c) - R^b == R^(b+2c) - R^(b+c) have equal fingerprints, wrapping around is fine
+    return f1.constants - f0.constants == f2.constants - f1.constants;
+}
+
+void scout::Relation::AddPowerOfRelation(int power, matrix m)
+{
+    if (this->powersOfRelation.contains(power))
+    {
+        return;
+    }
+    CachePower(power, std::make_shared<matrix const>(std::move(m)));
+}
 
-bool scout::Relation::ConsistencyCheck(matrix m)
+void scout::Relation::CachePower(int power, shared_matrix m)
 {
-    for (int i = 0; i < m.size(); ++i)
+    power_fingerprint fingerprint;
+    for (int i = 0; i < m->Size(); ++i)
     {
-        if (m[i][i][0].second < 0)
+        for (int j = 0; j < m->Size(); ++j)
+        {
+            auto c = (*m)(i, j);
+            if (c.empty())
+            {
+                continue;
+            }
+            if (c.size() > 1 || c[0].first != 0)
+            {
+                fingerprint.nonParametric = false;
+            }
+            auto index = std::uint64_t(i) * std::uint64_t(m->Size()) + std::uint64_t(j);
+            fingerprint.cells += cellWeight(2 * index);
+            fingerprint.constants += cellWeight(2 * index + 1) * std::uint64_t(std::int64_t(c[0].second));
+        }
+    }
+    auto bytes = m->MemoryUsage();
+    if constexpr (COLLECT_STATS)
+    {
+        ++stats.powersMaterialized;
+        stats.cells += std::uint64_t(m->Size()) * m->Size();
+        stats.terms += m->TermCount();
+        stats.peakTermsPerCell = std::max<std::uint64_t>(stats.peakTermsPerCell, m->MaxCellLength());
+    }
+    this->powersOfRelation.emplace(power, cached_power{std::move(m), bytes, ++this->powerCacheClock, fingerprint});
+    this->powerCacheBytes += bytes;
+    if constexpr (COLLECT_STATS)
+    {
+        stats.peakPowersBytes = std::max(stats.peakPowersBytes, this->powerCacheBytes);
+    }
+    EvictPowers();
+}
+
+void scout::Relation::SetPowerCacheBudget(std::size_t bytes)
+{
+    this->powerCacheBudget = bytes;
+    EvictPowers();
+}
+
+void scout::Relation::EvictPowers()
+{
+    if (this->powerCacheBudget == 0)
+    {
+        return;
+    }
+    // the power used last is kept as well, callers look it up right after adding it
+    auto evictable = [this](int power, cached_power const& cached)
+    { return !std::has_single_bit(unsigned(power)) && cached.m.use_count() == 1 && cached.lastUse != this->powerCacheClock; };
+    std::size_t evictableBytes = 0;
+    for (auto const& [power, cached] : this->powersOfRelation)
+    {
+        if (evictable(power, cached))
+        {
+            evictableBytes += cached.bytes;
+        }
+    }
+    while (evictableBytes > this->powerCacheBudget)
+    {
+        auto oldest = this->powersOfRelation.end();
+        for (auto it = this->powersOfRelation.begin(); it != this->powersOfRelation.end(); ++it)
+        {
+            if (evictable(it->first, it->second) && (oldest == this->powersOfRelation.end() || it->second.lastUse < oldest->second.lastUse))
+            {
+                oldest = it;
+            }
+        }
+        evictableBytes -= oldest->second.bytes;
+        this->powerCacheBytes -= oldest->second.bytes;
+        this->powersOfRelation.erase(oldest);
+        RecordStats([](ClosureStats& stats) { ++stats.powersEvicted; });
+    }
+}
+
+bool scout::Relation::ConsistencyCheck(matrix const& m)
+{
+    for (int i = 0; i < m.Size(); ++i)
+    {
+        if (m(i, i)[0].second < 0)
         { // only works because center diagonal is always < INF
             return false;
         }
@@ -340,12 +685,12 @@ bool scout::Relation::ConsistencyCheck(matrix m)
     return true;
 }
 
-std::optional<int> scout::Relation::ParametricConsistencyCheck(int alpha, int beta)
+std::optional<int> scout::Relation::ParametricConsistencyCheck(term_value alpha, term_value beta)
 {
     std::optional<int> gamma;
     if (alpha < 0)
     {
-        gamma = std::max(2, ((beta / (-1 * alpha)) + 1));
+        gamma = std::max(2, boundToInt(TermSum(beta / TermProduct(-1, alpha), 1)));
     }
     else if (alpha * 0 + beta < 0)
     {
@@ -356,206 +701,409 @@ std::optional<int> scout::Relation::ParametricConsistencyCheck(int alpha, int be
 
 void scout::Relation::CalcAddPowerOfRelation(int power)
 {
-    auto closestPower = SearchPowerOfRelation(power);
-    while (closestPower.first < power)
+    StatsScope scope(stats);
+    PhaseTimer timer(stats.powersSeconds);
+    if (power <= 0)
     {
-        ++closestPower.first;
-        closestPower.second = CalcNextPowerOfRelation(closestPower.second);
-        AddPowerOfRelation(closestPower.first, closestPower.second);
+        throw std::invalid_argument("Searched for negative power of relation.");
+    }
+    if (this->pipeline != nullptr)
+    {
+        this->pipeline->Take(power);
+    }
+    CalcPowerByAdditionChain(power);
+}
+
+bool scout::Relation::CalcPowerByAdditionChain(int power, bool keepEmpty)
+{
+    if (this->powersOfRelation.contains(power))
+    {
+        return true;
+    }
+    // R^power = R^lower o R^(power - lower) for the highest cached lower. Splitting no lower than power / 2 keeps both
+    // parts at most half of power, so a far jump costs O(log power) compositions. Single steps stay R^(power - 1) o R^1.
+    int lower = std::prev(this->powersOfRelation.lower_bound(power))->first;
+    if (lower < power / 2)
+    {
+        CalcPowerByAdditionChain(power / 2);
+        lower = power / 2;
+    }
+    // holding R^lower keeps it from being evicted while the other part is computed
+    auto lowerPower = this->powersOfRelation.at(lower).m;
+    CalcPowerByAdditionChain(power - lower);
+    auto upperPower = this->powersOfRelation.at(power - lower).m;
+    CheckDeadline();
+    if (keepEmpty)
+    {
+        AddPowerOfRelation(power, MatrixOperations::ComposeClosed(*lowerPower, *upperPower, this->isOctagonal));
+        return true;
+    }
+    matrix m;
+    if (!MatrixOperations::ComposeClosedIfConsistent(m, *lowerPower, *upperPower, this->isOctagonal))
+    {
+        RecordStats([](ClosureStats& stats) { ++stats.powersStoppedEmpty; });
+        return false;
+    }
+    AddPowerOfRelation(power, std::move(m));
+    return true;
+}
+
+scout::shared_matrix scout::Relation::GetConsistentPowerOfRelation(int power)
+{
+    // with a budget the power is kept like any other, evicting depends on which powers are cached
+    if (this->powerCacheBudget == 0)
+    {
+        StatsScope scope(stats);
+        PhaseTimer timer(stats.powersSeconds);
+        if (this->pipeline != nullptr)
+        {
+            this->pipeline->Take(power);
+        }
+        if (!CalcPowerByAdditionChain(power, false))
+        {
+            return nullptr;
+        }
     }
+    auto m = GetPowerOfRelation(power);
+    PhaseTimer consistencyTimer(stats.consistencySeconds);
+    return ConsistencyCheck(*m) ? m : nullptr;
 }
 
-scout::matrix scout::Relation::CalcNextPowerOfRelation(matrix m)
+scout::shared_matrix scout::Relation::GetPowerOfRelation(int power)
 {
-    m = MatrixOperations::MatrixComposition(m, this->powersOfRelation[1], this->isOctagonal);
+    CalcAddPowerOfRelation(power);
+    auto& cached = this->powersOfRelation.at(power);
+    cached.lastUse = ++this->powerCacheClock;
+    return cached.m;
+}
 
-    m = MatrixOperations::CalcExtremalPaths(m);
+scout::matrix scout::Relation::CalcNextPowerOfRelation(matrix const& m)
+{
+    return MatrixOperations::ComposeClosed(m, *GetPowerOfRelation(1), this->isOctagonal);
+}
 
-    return m;
+void scout::Relation::PrintTransitiveClosure(std::ostream& out) const
+{
+    StreamSink sink(out);
+    ClosureWriter writer(sink, ClosureWriter::TEXT);
+    writer.Write(*this);
 }
 
-void scout::Relation::PrintTransitiveClosure()
+void scout::Relation::WriteTransitiveClosure(OutputSink& sink, ClosureWriter::closureFormat format) const
 {
-    auto numberOfRelations = transitiveClosure.size();
-    std::string fileString;
-    auto containsK = false;
+    ClosureWriter writer(sink, format);
+    writer.Write(*this);
+}
 
+std::vector<scout::shared_matrix> const& scout::Relation::GetTransitiveClosure() const
+{
+    return this->transitiveClosure;
+}
 
-    fileString.append(";Variable declarations\n");
-    for (auto const& var : variableMap)
+std::string scout::Relation::SearchVariable(int value) const
+{
+    // matrix indices [0, n) are the variables, [n, 2n) their primed copies
+    ++value;
+    auto size = this->symbols.Size();
+    if (value >= 1 && value <= size)
     {
-        fileString.append("(declare-fun |" + var.second + "| () Int)\n");
-        fileString.append("(declare-fun |" + var.second + "'| () Int)\n");
+        return this->symbols.Name(value);
     }
-    fileString.append("(declare-fun |$k| () Int)\n");
-    fileString.append("(declare-fun k () Int)\n");
-    fileString.append("(declare-fun t0 () bool)\n");
-    fileString.append("(declare-fun t1 () bool)\n");
-    for (auto i = 0; i < numberOfRelations; ++i)
+    if (value > size && value <= 2 * size)
     {
-        fileString.append("(declare-fun s" + std::to_string(i) + " () bool)\n");
+        return this->symbols.Name(value - size) + "'";
     }
-    fileString.append("\n;Constraints\n");
+    return "null";
+}
+
+// ===============================================
+// binary snapshots
+
+static constexpr char FILE_MAGIC[8] = {'S', 'C', 'O', 'U', 'T', 'R', 'E', 'L'};
+static constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+static constexpr std::uint32_t OCTAGONAL_FLAG = 1;
+// the terms are int64, see term_value; files of int32 terms do not set it
+static constexpr std::uint32_t WIDE_TERMS_FLAG = 2;
+
+// terms are written and read as their two values
+static_assert(sizeof(scout::term) == 2 * sizeof(scout::term_value) && std::is_standard_layout_v<scout::term>);
+
+struct file_header
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder;
+    std::uint32_t flags;
+    std::int32_t prefix;
+    std::uint32_t variables;
+    std::uint32_t powers;
+    std::uint32_t closureParts;
+    // FNV-1a over the header, with this field 0, and everything after it
+    std::uint32_t checksum;
+};
 
-    int k = 0;
-    for (auto matrix : this->transitiveClosure)
+// the arrays after the header are aligned relative to the start of the snapshot
+static_assert(sizeof(file_header) % 8 == 0);
+
+static std::uint32_t snapshotChecksum(file_header header, std::string_view payload)
+{
+    header.checksum = 0;
+    std::uint32_t hash = 2166136261u;
+    auto add = [&](std::string_view bytes)
     {
-        ++k;
-        std::cout << "(";
-        fileString.append("(assert (= s" + std::to_string(k - 1) + " (and ");
-        if (this->isOctagonal)
+        for (auto byte : bytes)
         {
-            int relationHalfSize = (int)matrix.size() / 2;
-            for (int i = 0; i < relationHalfSize; ++i)
-            {
-                int valI = i;
-                int inputI = i;
-                for (int j = i; j < relationHalfSize; ++j)
-                {
-                    int valJ = j;
-                    int inputJ = j;
+            hash ^= std::uint8_t(byte);
+            hash *= 16777619u;
+        }
+    };
+    add(std::string_view(reinterpret_cast<char const*>(&header), sizeof(header)));
+    add(payload);
+    return hash;
+}
 
-                    if (i == j)
-                    {
-                        PrintCell(matrix[2 * valI][2 * valI + 1], inputI, inputJ, '\0', '+', fileString, containsK);
-                        PrintCell(matrix[2 * valI + 1][2 * valI], inputI, inputJ, '-', '-', fileString, containsK);
-                        continue;
-                    }
+static void writeBytes(std::ostream& out, void const* data, std::size_t size, std::size_t& written)
+{
+    out.write(static_cast<char const*>(data), std::streamsize(size));
+    written += size;
+}
 
-                    if (matrix[2 * valI][2 * valJ] == matrix[2 * valJ + 1][2 * valI + 1])
-                    { // def 2.18
-                        PrintCell(matrix[2 * valI][2 * valJ], inputI, inputJ, '\0', '-', fileString, containsK);
-                    }
-                    if (matrix[2 * valJ][2 * valI] == matrix[2 * valI + 1][2 * valJ + 1])
-                    {
-                        PrintCell(matrix[2 * valJ][2 * valI], inputI, inputJ, '-', '+', fileString, containsK);
-                    }
-                    if (matrix[2 * valI + 1][2 * valJ] == matrix[2 * valJ + 1][2 * valI])
-                    {
-                        PrintCell(matrix[2 * valI + 1][2 * valJ], inputI, inputJ, '-', '-', fileString, containsK);
-                    }
-                    if (matrix[2 * valI][2 * valJ + 1] == matrix[2 * valJ][2 * valI + 1])
-                    {
-                        PrintCell(matrix[2 * valI][2 * valJ + 1], inputI, inputJ, '\0', '+', fileString, containsK);
-                    }
-                }
-            }
+template <typename T>
+static void writeValue(std::ostream& out, T const& value, std::size_t& written)
+{
+    writeBytes(out, &value, sizeof(T), written);
+}
+
+// keeps every array 8 byte aligned relative to the start of the snapshot
+static void writePadding(std::ostream& out, std::size_t& written)
+{
+    static constexpr char zeros[8] = {};
+    writeBytes(out, zeros, (8 - written % 8) % 8, written);
+}
+
+static void writeMatrix(std::ostream& out, scout::matrix const& m, std::size_t& written)
+{
+    std::vector<std::uint32_t> lengths;
+    lengths.reserve(std::size_t(m.Size()) * m.Size());
+    std::uint64_t terms = 0;
+    for (int i = 0; i < m.Size(); ++i)
+    {
+        for (int j = 0; j < m.Size(); ++j)
+        {
+            lengths.emplace_back(std::uint32_t(m(i, j).size()));
+            terms += m(i, j).size();
         }
-        else
+    }
+    writeValue(out, std::int32_t(m.Size()), written);
+    writeValue(out, std::uint32_t(0), written);
+    writeValue(out, terms, written);
+    writeBytes(out, lengths.data(), lengths.size() * sizeof(std::uint32_t), written);
+    writePadding(out, written);
+    for (int i = 0; i < m.Size(); ++i)
+    {
+        for (int j = 0; j < m.Size(); ++j)
         {
-            for (int i = 0; i < matrix.size(); ++i)
-            {
-                for (int j = 0; j < matrix.size(); ++j)
-                {
-                    int valI = i;
-                    int valJ = j;
-                    if (i == j)
-                    {
-                        continue;
-                    }
-                    PrintCell(matrix[i][j], valI, valJ, '\0', '-', fileString, containsK);
-                }
-            }
+            writeBytes(out, m(i, j).data(), m(i, j).size_bytes(), written);
         }
-        if (containsK)
+    }
+}
+
+// bounds checked reads from a snapshot
+struct snapshot_reader
+{
+    std::string_view data;
+    std::size_t position = 0;
+
+    // throws unless count items of itemSize bytes are left, checked before anything is allocated for them
+    void Require(std::uint64_t count, std::size_t itemSize) const
+    {
+        if (count > (data.size() - position) / itemSize)
         {
-            fileString.append(" (>= |$k| 0))))\n");
-            std::cout << " k >= 0)";
-            containsK = false;
+            throw std::invalid_argument("Truncated relation file");
         }
-        else
+    }
+
+    void ReadBytes(void* target, std::size_t size)
+    {
+        Require(size, 1);
+        std::memcpy(target, data.data() + position, size);
+        position += size;
+    }
+
+    template <typename T>
+    T Read()
+    {
+        T value;
+        ReadBytes(&value, sizeof(T));
+        return value;
+    }
+
+    void SkipPadding() { position = std::min(data.size(), position + (8 - position % 8) % 8); }
+
+    scout::matrix ReadMatrix()
+    {
+        auto size = Read<std::int32_t>();
+        static_cast<void>(Read<std::uint32_t>());
+        auto terms = Read<std::uint64_t>();
+        if (size < 0)
         {
-            fileString.append(" )))\n");
-            std::cout << " )";
+            throw std::invalid_argument("Corrupt relation file");
         }
+        Require(std::uint64_t(size) * std::uint64_t(size), sizeof(std::uint32_t));
+        std::vector<std::uint32_t> lengths(std::size_t(size) * size);
+        ReadBytes(lengths.data(), lengths.size() * sizeof(std::uint32_t));
+        SkipPadding();
+        std::uint64_t total = 0;
+        for (auto length : lengths)
+        {
+            total += length;
+        }
+        if (total != terms)
+        {
+            throw std::invalid_argument("Corrupt relation file");
+        }
+        Require(terms, sizeof(scout::term));
+        scout::cell cells(terms);
+        ReadBytes(cells.data(), cells.size() * sizeof(scout::term));
+        scout::matrix m;
+        m.Reset(size, lengths, cells);
+        return m;
+    }
+};
+
+void scout::Relation::Save(std::ostream& out) const
+{
+    file_header header{};
+    std::copy(std::begin(FILE_MAGIC), std::end(FILE_MAGIC), header.magic);
+    header.version = FILE_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.flags = (this->isOctagonal ? OCTAGONAL_FLAG : 0) | (sizeof(term_value) == sizeof(std::int64_t) ? WIDE_TERMS_FLAG : 0);
+    header.prefix = this->prefix;
+    header.variables = std::uint32_t(this->symbols.Size());
+    header.powers = std::uint32_t(this->powersOfRelation.size());
+    header.closureParts = std::uint32_t(this->transitiveClosure.size());
 
-        if (k < numberOfRelations)
+    // the payload is written first for the checksum; it starts right after the header, which keeps it aligned
+    std::ostringstream payload;
+    std::size_t written = sizeof(file_header);
+    for (int number = 1; number <= this->symbols.Size(); ++number)
+    {
+        auto const& name = this->symbols.Name(number);
+        writeValue(payload, std::int32_t(number), written);
+        writeValue(payload, std::uint32_t(name.size()), written);
+        writeBytes(payload, name.data(), name.size(), written);
+        writePadding(payload, written);
+    }
+    for (auto const& [power, cached] : this->powersOfRelation)
+    {
+        writeValue(payload, std::int64_t(power), written);
+        writeMatrix(payload, *cached.m, written);
+    }
+    for (auto const& part : this->transitiveClosure)
+    {
+        auto shared = std::find_if(this->powersOfRelation.begin(), this->powersOfRelation.end(), [&](auto const& power) { return power.second.m == part; });
+        writeValue(payload, std::int64_t(shared != this->powersOfRelation.end() ? shared->first : 0), written);
+        if (shared == this->powersOfRelation.end())
         {
-            std::cout << " || \n";
+            writeMatrix(payload, *part, written);
         }
     }
-    fileString.append("\n(assert (= t0 (or");
-    for (int i = 0; i < numberOfRelations; ++i)
+    header.checksum = snapshotChecksum(header, payload.view());
+    out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    out.write(payload.view().data(), std::streamsize(payload.view().size()));
+    if (!out)
     {
-        fileString.append(" s" + std::to_string(i));
+        throw std::runtime_error("Writing the relation failed");
     }
-    fileString.append(")))");
+}
 
-    if (MAKE_SMT)
+void scout::Relation::Save(std::string const& filePath) const
+{
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file)
     {
-        std::ofstream file("/path/to/file");
-        file << fileString;
-        file.close();
+        throw std::invalid_argument("Cannot open file for writing");
     }
+    Save(file);
 }
 
-void scout::Relation::PrintCell(cell c, int valI, int valJ, char signOne, char signTwo, std::string& fileString, bool& containsK)
+scout::Relation scout::Relation::FromSnapshot(std::string_view snapshot)
 {
-    if (c.empty())
+    snapshot_reader reader{snapshot};
+    auto header = reader.Read<file_header>();
+    if (!std::equal(std::begin(FILE_MAGIC), std::end(FILE_MAGIC), header.magic) || header.byteOrder != BYTE_ORDER_MARK)
     {
-        return;
+        throw std::invalid_argument("Not a relation file");
     }
-    fileString.append("(<= (");
-    fileString += signTwo;
-    fileString += ' ';
-
-    if (signOne == '-')
+    if (header.version != FILE_VERSION)
     {
-        std::cout << signOne << SearchVariable(valI);
-        fileString += '(';
-        fileString += signOne;
-        fileString.append(" |" + SearchVariable(valI) + "|)");
+        throw std::invalid_argument("Unsupported relation file version " + std::to_string(header.version));
     }
-    else
+    if (((header.flags & WIDE_TERMS_FLAG) != 0) != (sizeof(term_value) == sizeof(std::int64_t)))
     {
-        std::cout << SearchVariable(valI);
-        fileString.append("|" + SearchVariable(valI) + "|");
+        throw std::invalid_argument("Relation file has terms of another SCOUT_TERM_TYPE");
+    }
+    if (snapshotChecksum(header, snapshot.substr(sizeof(file_header))) != header.checksum)
+    {
+        throw std::invalid_argument("Corrupt relation file");
     }
-    std::cout << signTwo << SearchVariable(valJ) << "<=";
-    fileString.append(" |" + SearchVariable(valJ) + "|) ");
-
-    auto alpha = c[0].first;
-    auto beta = c[0].second;
 
-    if (beta != 0 && alpha != 0)
+    Relation r;
+    r.isOctagonal = (header.flags & OCTAGONAL_FLAG) != 0;
+    r.prefix = header.prefix;
+    for (std::uint32_t i = 0; i < header.variables; ++i)
     {
-        containsK = true;
-        std::cout << alpha << "k";
-        if (beta > 0)
+        auto number = reader.Read<std::int32_t>();
+        auto length = reader.Read<std::uint32_t>();
+        reader.Require(length, 1);
+        std::string name(length, '\0');
+        reader.ReadBytes(name.data(), name.size());
+        reader.SkipPadding();
+        if (r.symbols.Intern(name) != number)
         {
-            std::cout << "+";
+            throw std::invalid_argument("Corrupt relation file");
         }
-        std::cout << beta;
-        fileString.append("(+ (* " + std::to_string(alpha) + " |$k|) " + std::to_string(beta) + ")");
     }
-    else if (alpha != 0)
+    for (std::uint32_t i = 0; i < header.powers; ++i)
     {
-        containsK = true;
-        std::cout << alpha << "k";
-        fileString.append("(* " + std::to_string(alpha) + " |$k|)");
+        // the powers are stored in ascending order, so R^1 comes first and the others have its size
+        auto power = reader.Read<std::int64_t>();
+        auto m = reader.ReadMatrix();
+        if (i == 0 ? power != 1 : power <= 1 || power > std::numeric_limits<int>::max() || m.Size() != r.powersOfRelation.at(1).m->Size())
+        {
+            throw std::invalid_argument("Corrupt relation file");
+        }
+        r.AddPowerOfRelation(int(power), std::move(m));
     }
-    else
+    if (!r.powersOfRelation.contains(1))
     {
-        std::cout << beta;
-        fileString.append(std::to_string(beta));
+        throw std::invalid_argument("Corrupt relation file");
     }
-    std::cout << ",";
-    fileString.append(") ");
-}
-
-std::string scout::Relation::SearchVariable(int value)
-{
-    ++value;
-    for (auto const& pair : this->variableMap)
+    for (std::uint32_t i = 0; i < header.closureParts; ++i)
     {
-        if (pair.first == value)
+        auto power = int(reader.Read<std::int64_t>());
+        if (power == 0)
         {
-            return pair.second;
+            auto part = reader.ReadMatrix();
+            if (part.Size() != r.powersOfRelation.at(1).m->Size())
+            {
+                throw std::invalid_argument("Corrupt relation file");
+            }
+            r.transitiveClosure.emplace_back(std::make_shared<matrix const>(std::move(part)));
+            continue;
         }
-        else if (pair.first == value - this->variableMap.size())
+        auto cached = r.powersOfRelation.find(power);
+        if (cached == r.powersOfRelation.end())
         {
-            return pair.second + "'";
+            throw std::invalid_argument("Corrupt relation file");
         }
+        r.transitiveClosure.emplace_back(cached->second.m);
     }
-    return "null";
+    return r;
+}
+
+scout::Relation scout::Relation::Load(std::string const& filePath)
+{
+    MappedFile file(filePath);
+    return FromSnapshot(file.Text());
 }
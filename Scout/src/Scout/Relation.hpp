@@ -1,64 +1,211 @@
 #pragma once
 
+#include <chrono>
+#include <filesystem>
 #include <iostream>
 #include <map>
 #include <optional>
 #include <set>
+#include <stdexcept>
+#include <string_view>
 #include <vector>
 
+#include "ClosureWriter.hpp"
 #include "Common.hpp"
+#include "Matrix.hpp"
 #include "MatrixOperations.hpp"
+#include "Stats.hpp"
+#include "SymbolTable.hpp"
 
 namespace scout
 {
+// thrown by Relation::CalculateTransitiveClosure once the deadline set on the relation has passed
+class ClosureTimeout : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
 class Relation
 {
 public:
     // algorithm 1 of the thesis
     void CalculateTransitiveClosure();
 
+    // CalculateTransitiveClosure gives up with ClosureTimeout when it is still running at deadline. The deadline is
+    // checked between powers, a single power is always completed.
+    void SetDeadline(std::chrono::steady_clock::time_point deadline);
+
+    // CalculateTransitiveClosure first looks for the closure of an identical relation, up to variable names and
+    // conjunct order, in directory and stores its result there otherwise; a file it cannot load counts as a miss and is
+    // replaced. If the directory cannot be written, the closure is returned without storing it. With a cache the closure
+    // is always computed on the canonical form of the relation, so hits and misses print the same.
+    void SetCacheDirectory(std::filesystem::path directory);
+
+    // With speculative candidates CalculateTransitiveClosure evaluates the candidates c of a round on the threads of
+    // MatrixOperations::GetThreadPool, as many at a time as it has threads, and commits them in the order of c. The
+    // closure is the same as without, a window may only compute Lambdas that are not needed in the end.
+    void SetSpeculativeCandidates(bool enabled);
+
+    // With a look-ahead of n > 0 a thread of its own computes up to n of the powers a round of CalculateTransitiveClosure
+    // is going to ask for while the round checks the powers it already has. The closure is the same as without. Not
+    // used together with a power cache budget, whose evictions depend on the order the powers are used in.
+    void SetPowerLookAhead(int powers);
+
+    // what parsing and closing this relation took so far; stays zero unless built with SCOUT_STATS
+    [[nodiscard]] ClosureStats const& GetStats() const;
+    ClosureStats& GetStats();
+
     // maxConsistent
-    std::optional<int> MaxConsistent(int b, matrix LambdaB);
+    std::optional<int> MaxConsistent(int b, matrix const& LambdaB);
     // minGamma in the thesis
-    static std::optional<int> ParametricConsistencyCheck(int alpha, int beta);
+    static std::optional<int> ParametricConsistencyCheck(term_value alpha, term_value beta);
 
     // maxPeriodic
     std::optional<int> MaxPeriodic(matrix const& LambdaB, int c);
     // min Kappa in the thesis
     static std::optional<int> CheckPeriod(matrix const& LambdaB, matrix const& m2, int const l);
 
-    // prints the calculatedTransitiveClosure; if you set MAX_SMT in common.h to true it will also make an SMTLIB file (requires you to manually change the path)
-    void PrintTransitiveClosure();
+    // prints the calculatedTransitiveClosure as text
+    void PrintTransitiveClosure(std::ostream& out = std::cout) const;
+
+    // the calculatedTransitiveClosure in any of the ClosureWriter formats, e.g. SMT-LIB to a FileDescriptorSink
+    void WriteTransitiveClosure(OutputSink& sink, ClosureWriter::closureFormat format) const;
 
-    void PrintCell(cell c, int valI, int valJ, char signOne, char signTwo, std::string& fileString, bool& containsK);
+    // the parts of the transitive closure, in the order they are printed
+    [[nodiscard]] std::vector<shared_matrix> const& GetTransitiveClosure() const;
 
-    std::string SearchVariable(int value);
+    std::string SearchVariable(int value) const;
 
-    void SetVariableMap(std::map<int, std::string> const& variableMap);
 
-    std::map<int, std::string> GetVariableMap();
+    // the variables of the relation; the parser interns them while tokenizing
+    [[nodiscard]] SymbolTable const& GetSymbolTable() const;
+    SymbolTable& GetSymbolTable();
 
     void SetIsOctagonal(bool isOctagonal);
 
     [[nodiscard]] bool GetIsOctagonal() const;
 
-    void AddPowerOfRelation(int power, matrix const& m);
+    void AddPowerOfRelation(int power, matrix m);
 
+    // computes R^power from the cached powers, see CalcPowerByAdditionChain
     void CalcAddPowerOfRelation(int power);
 
-    matrix CalcNextPowerOfRelation(matrix m);
+    // R^power, computed if it is not cached. The matrix stays valid while the pointer is held, even if the cache drops it.
+    shared_matrix GetPowerOfRelation(int power);
+
+    // Limits the bytes powersOfRelation keeps alive on its own, 0 (the default) keeps every power. R^1 and the powers of
+    // two are checkpoints that are always kept, other powers are dropped least recently used first and recomputed from
+    // the checkpoints if needed again. Powers that are also part of the transitive closure are not dropped.
+    void SetPowerCacheBudget(std::size_t bytes);
+
+    matrix CalcNextPowerOfRelation(matrix const& m);
+
+    // the highest cached power up to power, shared with the cache
+    std::pair<int, shared_matrix> SearchPowerOfRelation(int power);
+
+    static bool ConsistencyCheck(matrix const& m);
+
+    // Binary snapshot of the variable map, the cached powers (R^1 included) and the transitive closure, in native byte
+    // order. All arrays are 8 byte aligned and stored as they are held in memory, so loading only copies them; a
+    // closure part that is a cached power refers to it instead of being stored twice. The header holds a checksum of the
+    // whole snapshot.
+    void Save(std::ostream& out) const;
+    void Save(std::string const& filePath) const;
 
-    std::pair<int, matrix> SearchPowerOfRelation(int power);
+    // reads a snapshot written by Save; throws std::invalid_argument if it is not one of this version or its checksum
+    // does not match
+    static Relation Load(std::string const& filePath);
+    static Relation FromSnapshot(std::string_view snapshot);
 
-    static bool ConsistencyCheck(matrix m);
+    static constexpr std::uint32_t FILE_VERSION = 2;
 
 
 private:
-    std::map<int, std::string> variableMap;
-    std::map<int, matrix> powersOfRelation;
-    std::vector<matrix> transitiveClosure;
+    void CheckDeadline() const;
+
+    // CalculateTransitiveClosure through the cache directory
+    void CalculateCachedTransitiveClosure();
+
+    // With keepEmpty false, R^power is not cached if it turns out to be an empty relation, and the last composition of
+    // its chain stops as soon as that is clear; the result is then false.
+    bool CalcPowerByAdditionChain(int power, bool keepEmpty = true);
+
+    // R^power, or nullptr if it fails ConsistencyCheck. An empty power is only computed as far as needed and not cached,
+    // unless the cache has a budget.
+    shared_matrix GetConsistentPowerOfRelation(int power);
+
+    // puts m into powersOfRelation, see AddPowerOfRelation
+    void CachePower(int power, shared_matrix m);
+
+    // see SetPowerLookAhead
+    class PowerPipeline;
+
+    // R^b, R^(b+c) and R^(b+2c) of a candidate, and R^c if it was fetched ahead for MaxPeriodic
+    struct candidate_powers
+    {
+        shared_matrix b;
+        shared_matrix bc;
+        shared_matrix b2c;
+        shared_matrix c;
+    };
+
+    // the closed LambdaB of a candidate if the differences of its powers are equal, and the L it allows to skip;
+    // no L means that LambdaB and its compositions with R^1 to R^(c-1) are the closure
+    struct period_candidate
+    {
+        std::optional<matrix> LambdaB;
+        std::optional<int> L;
+    };
+
+    // Lambda, maxConsistent and maxPeriodic of the candidate (b, c). Only reads the power cache if powers.c is set, so
+    // candidates can then be evaluated at the same time; times are added to candidateStats.
+    period_candidate EvaluateCandidate(int b, int c, candidate_powers const& powers, ClosureStats& candidateStats);
+
+    // maxPeriodic with R^c given
+    std::optional<int> MaxPeriodic(matrix const& LambdaB, matrix const& powerC) const;
+
+    // drops powers until the cache is within powerCacheBudget
+    void EvictPowers();
+
+    // false if the fingerprints of R^b, R^(b+c) and R^(b+2c) rule out that their two differences are equal, in which
+    // case the Lambda of (b, c) does not need to be computed. The powers have to be in the cache.
+    bool MayHaveEqualDifferences(int b, int c) const;
+
+    // Sums of a random weight per cell over the non-empty cells and over their constants. The constant sum is linear, so
+    // the fingerprint of R^(b+c) - R^b is the difference of the fingerprints of the powers.
+    struct power_fingerprint
+    {
+        std::uint64_t cells = 0;
+        std::uint64_t constants = 0;
+        // false if a cell holds more than one term or a term with k, the sums do not cover those
+        bool nonParametric = true;
+    };
+
+    struct cached_power
+    {
+        shared_matrix m;
+        std::size_t bytes = 0;
+        // value of powerCacheClock at the last use
+        std::uint64_t lastUse = 0;
+        power_fingerprint fingerprint;
+    };
+
+    SymbolTable symbols;
+    std::map<int, cached_power> powersOfRelation;
+    std::size_t powerCacheBudget = 0;
+    std::size_t powerCacheBytes = 0;
+    std::uint64_t powerCacheClock = 0;
+    std::vector<shared_matrix> transitiveClosure;
     int prefix = 0;
     bool isOctagonal;
     matrix test;
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    ClosureStats stats;
+    std::optional<std::filesystem::path> cacheDirectory;
+    bool speculativeCandidates = false;
+    int powerLookAhead = 0;
+    // the pipeline of the running round, GetPowerOfRelation takes its powers from there
+    PowerPipeline* pipeline = nullptr;
 };
 } // namespace scout
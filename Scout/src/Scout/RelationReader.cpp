@@ -0,0 +1,36 @@
+#include "RelationReader.hpp"
+
+#include <algorithm>
+#include <string_view>
+
+static std::string_view trim(std::string_view text)
+{
+    auto begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string_view::npos)
+    {
+        return {};
+    }
+    return text.substr(begin, text.find_last_not_of(" \t\r\n") - begin + 1);
+}
+
+scout::RelationReader::RelationReader(std::string const& filePath) : file(filePath) {}
+
+std::optional<scout::Relation> scout::RelationReader::Next()
+{
+    auto text = file.Text();
+    while (position < text.size())
+    {
+        auto end = std::min(text.find(';', position), text.size());
+        auto statement = text.substr(position, end - position);
+        position = end + 1;
+
+        auto colon = statement.find(':');
+        if (colon == std::string_view::npos)
+        {
+            continue;
+        }
+        name = trim(statement.substr(0, colon));
+        return Parser::ParseRelation(statement.substr(colon + 1), tokens);
+    }
+    return std::nullopt;
+}
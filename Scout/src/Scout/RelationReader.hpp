@@ -0,0 +1,34 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "Parser.hpp"
+#include "Relation.hpp"
+
+namespace scout
+{
+// Reads the relations of a file one at a time. A file is a sequence of statements ending in ';'; every statement of the
+// form "name: formula" is a relation, all other statements (e.g. "print R1^+k") are skipped. A single relation file is
+// the special case with one relation. The file is mapped, so only the parts that are read get loaded.
+class RelationReader
+{
+public:
+    explicit RelationReader(std::string const& filePath);
+
+    // parses the next relation, nullopt once the file is exhausted. If a relation fails to parse the exception is passed
+    // on and the next call continues with the relation after it.
+    std::optional<Relation> Next();
+
+    // name of the relation last returned or failed by Next
+    [[nodiscard]] std::string const& Name() const { return name; }
+
+private:
+    MappedFile file;
+    std::size_t position = 0;
+    std::string name;
+    std::vector<token> tokens;
+};
+} // namespace scout
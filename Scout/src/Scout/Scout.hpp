@@ -1,11 +1,25 @@
 #pragma once
 
+#include "Batch.hpp"
+#include "ClosureWriter.hpp"
 #include "Parser.hpp"
 #include "Relation.hpp"
+#include "RelationReader.hpp"
 
 /* Usage Example:
  *
  *   scout::Relation r = scout::Parser::RetrieveRelation(filePath);
  *   r.CalculateTransitiveClosure();
  *   r.PrintTransitiveClosure();
+ *
+ *   // the same closure as SMT-LIB on stdout, written through a buffer instead of constraint by constraint
+ *   scout::FileDescriptorSink sink(1);
+ *   r.WriteTransitiveClosure(sink, scout::ClosureWriter::SMT_LIB);
+ *
+ *   // many files in parallel, results are reported in input order
+ *   scout::Batch::Run(scout::Batch::CollectFiles({"dataset"}), {}, [](scout::BatchResult const& result) { ... });
+ *
+ *   // many relations in one file, parsed one at a time
+ *   scout::RelationReader reader(filePath);
+ *   while (auto relation = reader.Next()) { ... }
  */
@@ -0,0 +1,62 @@
+#include "Stats.hpp"
+
+#include <algorithm>
+
+static thread_local scout::ClosureStats* activeStats = nullptr;
+
+scout::ClosureStats* scout::ActiveStats() { return activeStats; }
+
+scout::StatsScope::StatsScope(ClosureStats& stats)
+{
+    if constexpr (COLLECT_STATS)
+    {
+        previous = activeStats;
+        activeStats = &stats;
+    }
+}
+
+scout::StatsScope::~StatsScope()
+{
+    if constexpr (COLLECT_STATS)
+    {
+        activeStats = previous;
+    }
+}
+
+void scout::ClosureStats::Merge(ClosureStats const& other)
+{
+    parseSeconds += other.parseSeconds;
+    initialClosureSeconds += other.initialClosureSeconds;
+    powersSeconds += other.powersSeconds;
+    consistencySeconds += other.consistencySeconds;
+    lambdaSeconds += other.lambdaSeconds;
+    maxConsistentSeconds += other.maxConsistentSeconds;
+    maxPeriodicSeconds += other.maxPeriodicSeconds;
+    transitiveClosureSeconds += other.transitiveClosureSeconds;
+    iterations += other.iterations;
+    jumps += other.jumps;
+    candidates += other.candidates;
+    candidatesFiltered += other.candidatesFiltered;
+    powersMaterialized += other.powersMaterialized;
+    powersStoppedEmpty += other.powersStoppedEmpty;
+    relaxations += other.relaxations;
+    matricesAllocated += other.matricesAllocated;
+    cells += other.cells;
+    terms += other.terms;
+    peakTermsPerCell = std::max(peakTermsPerCell, other.peakTermsPerCell);
+    peakPowersBytes = std::max(peakPowersBytes, other.peakPowersBytes);
+    powersEvicted += other.powersEvicted;
+}
+
+void scout::ClosureStats::PrintJson(std::ostream& out) const
+{
+    out << "{\"enabled\": " << (COLLECT_STATS ? "true" : "false");
+    out << ", \"seconds\": {\"parse\": " << parseSeconds << ", \"initial_closure\": " << initialClosureSeconds << ", \"powers\": " << powersSeconds
+        << ", \"consistency\": " << consistencySeconds << ", \"lambda\": " << lambdaSeconds << ", \"max_consistent\": " << maxConsistentSeconds
+        << ", \"max_periodic\": " << maxPeriodicSeconds << ", \"transitive_closure\": " << transitiveClosureSeconds << "}";
+    out << ", \"iterations\": " << iterations << ", \"jumps\": " << jumps << ", \"candidates\": " << candidates
+        << ", \"candidates_filtered\": " << candidatesFiltered;
+    out << ", \"powers_materialized\": " << powersMaterialized << ", \"powers_stopped_empty\": " << powersStoppedEmpty << ", \"relaxations\": " << relaxations << ", \"matrices_allocated\": " << matricesAllocated;
+    out << ", \"peak_terms_per_cell\": " << peakTermsPerCell << ", \"average_terms_per_cell\": " << AverageTermsPerCell();
+    out << ", \"peak_powers_bytes\": " << peakPowersBytes << ", \"powers_evicted\": " << powersEvicted << "}";
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+namespace scout
+{
+// configure with -DSCOUT_STATS=ON to collect ClosureStats, otherwise all recording compiles to nothing
+#ifdef SCOUT_STATS
+constexpr bool COLLECT_STATS = true;
+#else
+constexpr bool COLLECT_STATS = false;
+#endif
+
+// What a relation spent its time on. Phases nest: powers computed inside MaxPeriodic count for both.
+struct ClosureStats
+{
+    // seconds per phase
+    double parseSeconds = 0;
+    double initialClosureSeconds = 0;
+    double powersSeconds = 0;
+    double consistencySeconds = 0;
+    double lambdaSeconds = 0;
+    double maxConsistentSeconds = 0;
+    double maxPeriodicSeconds = 0;
+    double transitiveClosureSeconds = 0;
+
+    // rounds of the b loop in CalculateTransitiveClosure, and how many of them jumped by more than one
+    std::uint64_t iterations = 0;
+    std::uint64_t jumps = 0;
+    // (b, c) pairs whose powers were consistent, and how many of them were ruled out by fingerprints without computing
+    // their Lambda
+    std::uint64_t candidates = 0;
+    std::uint64_t candidatesFiltered = 0;
+
+    std::uint64_t powersMaterialized = 0;
+    // powers whose composition stopped at a negative diagonal cell instead of being materialized
+    std::uint64_t powersStoppedEmpty = 0;
+    // cells relaxed by the Floyd-Warshall kernels
+    std::uint64_t relaxations = 0;
+    // matrices constructed or copied
+    std::uint64_t matricesAllocated = 0;
+
+    // over all cells of the materialized powers
+    std::uint64_t cells = 0;
+    std::uint64_t terms = 0;
+    std::uint64_t peakTermsPerCell = 0;
+
+    // bytes held by powersOfRelation
+    std::size_t peakPowersBytes = 0;
+    // powers dropped to stay within the power cache budget
+    std::uint64_t powersEvicted = 0;
+
+    [[nodiscard]] double AverageTermsPerCell() const { return cells == 0 ? 0 : double(terms) / double(cells); }
+
+    // adds the counts and times of other, e.g. of work done on another thread, and takes the larger peaks
+    void Merge(ClosureStats const& other);
+
+    void PrintJson(std::ostream& out) const;
+};
+
+// the stats the kernels running on this thread report to, nullptr if there are none
+ClosureStats* ActiveStats();
+
+// makes stats the active stats of this thread for its lifetime
+class StatsScope
+{
+public:
+    explicit StatsScope(ClosureStats& stats);
+    ~StatsScope();
+
+    StatsScope(StatsScope const&) = delete;
+    StatsScope& operator=(StatsScope const&) = delete;
+
+private:
+    ClosureStats* previous = nullptr;
+};
+
+// adds the time until its destruction to seconds
+class PhaseTimer
+{
+public:
+    explicit PhaseTimer(double& seconds) : seconds(seconds)
+    {
+        if constexpr (COLLECT_STATS)
+        {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~PhaseTimer()
+    {
+        if constexpr (COLLECT_STATS)
+        {
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+
+    PhaseTimer(PhaseTimer const&) = delete;
+    PhaseTimer& operator=(PhaseTimer const&) = delete;
+
+private:
+    double& seconds;
+    std::chrono::steady_clock::time_point start;
+};
+
+// calls record(stats) on the active stats, if stats are compiled in and there are any
+template <typename F>
+void RecordStats(F const& record)
+{
+    if constexpr (COLLECT_STATS)
+    {
+        if (auto* stats = ActiveStats())
+        {
+            record(*stats);
+        }
+    }
+}
+} // namespace scout
@@ -0,0 +1,22 @@
+#include "SymbolTable.hpp"
+
+int scout::SymbolTable::Intern(std::string_view name)
+{
+    if (auto known = numbers.find(name); known != numbers.end())
+    {
+        return known->second;
+    }
+    names.emplace_back(name);
+    auto number = int(names.size());
+    numbers.emplace(names.back(), number);
+    return number;
+}
+
+std::optional<int> scout::SymbolTable::Find(std::string_view name) const
+{
+    if (auto known = numbers.find(name); known != numbers.end())
+    {
+        return known->second;
+    }
+    return std::nullopt;
+}
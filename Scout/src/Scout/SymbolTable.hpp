@@ -0,0 +1,40 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace scout
+{
+// Variable names of a relation, numbered 1, 2, ... in the order they were first seen. Both directions are O(1).
+class SymbolTable
+{
+public:
+    // the number of name, which is added if it is new
+    int Intern(std::string_view name);
+
+    [[nodiscard]] std::optional<int> Find(std::string_view name) const;
+
+    // name of number, which has to lie in [1, Size()]
+    [[nodiscard]] std::string const& Name(int number) const { return names[number - 1]; }
+
+    [[nodiscard]] int Size() const { return int(names.size()); }
+
+    // names in the order of their numbers
+    [[nodiscard]] std::vector<std::string> const& Names() const { return names; }
+
+private:
+    struct name_hash
+    {
+        using is_transparent = void;
+
+        std::size_t operator()(std::string_view name) const { return std::hash<std::string_view>()(name); }
+    };
+
+    std::vector<std::string> names;
+    std::unordered_map<std::string, int, name_hash, std::equal_to<>> numbers;
+};
+} // namespace scout
@@ -0,0 +1,119 @@
+#include "ThreadPool.hpp"
+
+// pool whose loop the current thread is working on, nested loops of the same pool run inline
+static thread_local scout::ThreadPool const* activePool = nullptr;
+
+scout::ThreadPool::ThreadPool(int size)
+{
+    for (int thread = 1; thread < size; ++thread)
+    {
+        workers.emplace_back(&ThreadPool::WorkerLoop, this, thread);
+    }
+}
+
+scout::ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(mutex);
+        stop = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void scout::ThreadPool::Run(int count, invoker invoke, void const* context)
+{
+    if (workers.empty() || count <= 1 || activePool == this)
+    {
+        for (int index = 0; index < count; ++index)
+        {
+            invoke(context, index, 0);
+        }
+        return;
+    }
+
+    std::lock_guard loopLock(loopMutex);
+    {
+        std::lock_guard lock(mutex);
+        this->invoke = invoke;
+        this->context = context;
+        this->count = count;
+        next = 0;
+        busyWorkers = int(workers.size());
+        failure = nullptr;
+        ++generation;
+    }
+    wake.notify_all();
+
+    RunTasks(0);
+
+    std::unique_lock lock(mutex);
+    finished.wait(lock, [this] { return busyWorkers == 0; });
+    this->invoke = nullptr;
+    this->context = nullptr;
+    if (failure)
+    {
+        std::rethrow_exception(failure);
+    }
+}
+
+void scout::ThreadPool::WorkerLoop(int thread)
+{
+    std::uint64_t seen = 0;
+    while (true)
+    {
+        {
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [&] { return stop || generation != seen; });
+            if (stop)
+            {
+                return;
+            }
+            seen = generation;
+        }
+
+        RunTasks(thread);
+
+        std::lock_guard lock(mutex);
+        if (--busyWorkers == 0)
+        {
+            finished.notify_one();
+        }
+    }
+}
+
+void scout::ThreadPool::RunTasks(int thread)
+{
+    auto const* previous = activePool;
+    activePool = this;
+    while (true)
+    {
+        int index;
+        {
+            std::lock_guard lock(mutex);
+            if (next >= count)
+            {
+                break;
+            }
+            index = next++;
+        }
+        try
+        {
+            invoke(context, index, thread);
+        }
+        catch (...)
+        {
+            // the first exception is rethrown by ParallelFor, the remaining indices are dropped
+            std::lock_guard lock(mutex);
+            if (!failure)
+            {
+                failure = std::current_exception();
+            }
+            next = count;
+        }
+    }
+    activePool = previous;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace scout
+{
+// Fixed set of worker threads for data parallel loops. The calling thread takes part in every loop, so a pool of size 1
+// has no workers and runs everything inline.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(int size);
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    [[nodiscard]] int Size() const { return int(workers.size()) + 1; }
+
+    // calls task(index, thread) for every index in [0, count) and returns once all calls are done; thread lies in
+    // [0, Size()) and is unique among the calls running at the same time. Calls from inside a task run inline.
+    template <typename F>
+    void ParallelFor(int count, F const& task)
+    {
+        // task is only referenced, so handing out a loop does not allocate
+        Run(count, [](void const* context, int index, int thread) { (*static_cast<F const*>(context))(index, thread); }, &task);
+    }
+
+private:
+    typedef void (*invoker)(void const* context, int index, int thread);
+
+    void Run(int count, invoker invoke, void const* context);
+
+    void WorkerLoop(int thread);
+
+    // takes indices of the current loop until none are left
+    void RunTasks(int thread);
+
+    std::vector<std::thread> workers;
+
+    std::mutex loopMutex;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+
+    invoker invoke = nullptr;
+    void const* context = nullptr;
+    int count = 0;
+    int next = 0;
+    int busyWorkers = 0;
+    std::uint64_t generation = 0;
+    std::exception_ptr failure;
+    bool stop = false;
+};
+} // namespace scout
@@ -0,0 +1,7 @@
+#include "Workspace.hpp"
+
+scout::Workspace& scout::Workspace::Local()
+{
+    static thread_local Workspace workspace;
+    return workspace;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <tuple>
+
+#include "Common.hpp"
+#include "DenseMatrix.hpp"
+#include "HalfMatrix.hpp"
+#include "Matrix.hpp"
+
+namespace scout
+{
+// scratch cells of one thread in the Floyd-Warshall loop
+struct closure_scratch
+{
+    cell tmp;
+    cell c1;
+    cell c2;
+    cell tmp2;
+    cell front;
+    // positions in c1 of the lower hull in relaxCell
+    counted_vector<std::size_t> hull;
+
+    // cells that did not fit their slot during a parallel sweep, (i, j, end of its terms in deferredTerms)
+    counted_vector<std::tuple<int, int, std::size_t>> deferredCells;
+    cell deferredTerms;
+
+    // relaxCell calls since the last report to ClosureStats
+    std::uint64_t relaxations = 0;
+};
+
+// operands, result and scratch of a composition on the dense kernels
+template <typename T>
+struct dense_buffers
+{
+    dense_matrix<T> m1;
+    dense_matrix<T> m2;
+    dense_matrix<T> res;
+    dense_scratch<T> scratch;
+};
+
+// the same for coherent matrices on the half matrix kernels
+template <typename T>
+struct half_buffers
+{
+    half_matrix<T> m1;
+    half_matrix<T> m2;
+    half_matrix<T> res;
+    half_scratch<T> scratch;
+};
+
+// Scratch buffers of the in-place kernels in MatrixOperations. The buffers only ever grow, so once a workspace has seen
+// matrices of some size and cell length, closing or composing such matrices again does not allocate. A workspace must
+// not be used by two calls at the same time, Local hands out one per thread.
+class Workspace
+{
+public:
+    static Workspace& Local();
+
+    template <typename T>
+    dense_buffers<T>& Dense()
+    {
+        if constexpr (sizeof(T) == sizeof(std::int32_t))
+        {
+            return dense32;
+        }
+        else
+        {
+            return dense64;
+        }
+    }
+
+    template <typename T>
+    half_buffers<T>& Half()
+    {
+        if constexpr (sizeof(T) == sizeof(std::int32_t))
+        {
+            return half32;
+        }
+        else
+        {
+            return half64;
+        }
+    }
+
+    // one per thread of MatrixOperations::GetThreadPool
+    counted_vector<closure_scratch> threads;
+
+    // HalfTerms of m(i, i') and m(j', j) for the tight closure
+    counted_vector<cell> rowHalves;
+    counted_vector<cell> columnHalves;
+    cell minTerms;
+
+    // block matrix of a parametric composition
+    matrix block;
+
+private:
+    dense_buffers<std::int32_t> dense32;
+    dense_buffers<std::int64_t> dense64;
+    half_buffers<std::int32_t> half32;
+    half_buffers<std::int64_t> half64;
+};
+} // namespace scout